@@ -0,0 +1,120 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Microbenchmark harness for the gb_bench target.
+//
+// A benchmark group is registered with BENCHMARK("group") and receives a
+// BenchRun, it builds whatever state it needs and then calls measure()
+// once per variant. measure() first finds how many calls fill a minimum
+// sample time, runs a few warm-up samples and then times the repetitions.
+// Results are nanoseconds per operation summarized by median and
+// percentiles, which stay stable when a sample is disturbed.
+
+struct BenchOptions {
+    std::string filter;        // only run names containing it
+    uint32_t repetitions;
+    uint32_t warmup;
+    double min_sample_millis;
+
+    BenchOptions() : repetitions(15), warmup(3), min_sample_millis(10) {}
+};
+
+struct BenchResult {
+    std::string name;
+    uint64_t ops_per_sample;
+    std::vector<double> samples; // ns per operation
+
+    double min;
+    double p10;
+    double median;
+    double p90;
+    double max;
+};
+
+// Keeps values the compiler could otherwise prove unused
+extern volatile uint32_t bench_sink;
+inline void bench_keep(uint32_t value) { bench_sink = value; }
+
+class BenchRun {
+private:
+    std::string group;
+    const BenchOptions& options;
+    std::vector<BenchResult>& results;
+
+    template <typename F>
+    double time_calls(F& op, uint64_t calls) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < calls; i++) {
+            op();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    void add_result(const std::string& name, uint64_t ops_per_sample, std::vector<double>& samples);
+
+public:
+    BenchRun(const std::string& group, const BenchOptions& options, std::vector<BenchResult>& results) :
+        group(group), options(options), results(results) {}
+
+    bool is_selected(const std::string& variant) const;
+
+    // Times op(), which performs ops_per_call operations per call
+    template <typename F>
+    void measure(const std::string& variant, F op, uint64_t ops_per_call = 1) {
+        if (!is_selected(variant)) {
+            return;
+        }
+
+        const double min_sample = options.min_sample_millis * 1e6;
+        uint64_t calls = 1;
+        double elapsed = time_calls(op, calls);
+        while (elapsed < min_sample && calls < (1ull << 40)) {
+            uint64_t scale = elapsed > 0 ? static_cast<uint64_t>(min_sample / elapsed * 1.2) + 1 : 16;
+            calls *= std::min<uint64_t>(std::max<uint64_t>(scale, 2), 16);
+            elapsed = time_calls(op, calls);
+        }
+
+        for (uint32_t i = 0; i < options.warmup; i++) {
+            time_calls(op, calls);
+        }
+
+        std::vector<double> samples;
+        for (uint32_t i = 0; i < options.repetitions; i++) {
+            samples.push_back(time_calls(op, calls) / (calls * ops_per_call));
+        }
+        add_result(variant, calls * ops_per_call, samples);
+    }
+};
+
+typedef void (*BenchFunction)(BenchRun&);
+
+struct BenchRegistration {
+    BenchRegistration(const char* group, BenchFunction function);
+};
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+#define BENCH_REGISTER(group, function) \
+    static void function(BenchRun&); \
+    static BenchRegistration BENCH_CONCAT(function, _registration)(group, function); \
+    static void function(BenchRun& run)
+#define BENCHMARK(group) BENCH_REGISTER(group, BENCH_CONCAT(bench_function_, __LINE__))
+
+class GBCartridge;
+
+// Cartridge with a generated ROM of the given header type and size codes
+// and every byte of a bank set to its bank number
+std::unique_ptr<GBCartridge> make_bench_cartridge(uint8_t cartridge_type, uint8_t rom_type, uint8_t ram_type = 0);
+
+void write_bench_json(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results);
+
+#endif
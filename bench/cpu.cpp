@@ -0,0 +1,79 @@
+/*
+ * bench/cpu.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include <vector>
+
+#include "cpu.hpp"
+
+const uint16_t kCodeBase = 0xc000;
+const uint16_t kCodeEnd  = 0xd000;
+const uint16_t kDataAddr = 0xd800;
+const uint16_t kCallAddr = 0xd000;
+
+// Fills 0xc000-0xcfff with the pattern and jumps back at the end, so the
+// jump is a negligible part of the instructions run
+static void load_pattern(GBMMU& mmu, GBCPU& cpu, const std::vector<uint8_t>& pattern) {
+    uint16_t addr = kCodeBase;
+    while (addr + pattern.size() + 3 <= kCodeEnd) {
+        for (uint8_t byte : pattern) {
+            mmu.write_byte(addr++, byte);
+        }
+    }
+    mmu.write_byte(addr++, 0xc3); // jp c000
+    mmu.write_byte(addr++, kCodeBase & 0xff);
+    mmu.write_byte(addr++, kCodeBase >> 8);
+
+    mmu.write_byte(kCallAddr, 0xc9); // ret
+
+    cpu.reg.pc = kCodeBase;
+    cpu.reg.sp = 0xdff0;
+    cpu.reg.hl = kDataAddr;
+    cpu.reg.f = 0x80; // z set, jr nz isn't taken
+}
+
+// Instruction classes as the dispatch sees them, ns per instruction
+BENCHMARK("cpu/dispatch") {
+    struct InstructionClass {
+        const char* name;
+        std::vector<uint8_t> pattern;
+    };
+
+    const InstructionClass classes[] = {
+        {"nop",          {0x00}},
+        {"ld_r_r",       {0x41}},             // ld b,c
+        {"ld_r_n",       {0x06, 0x12}},       // ld b,12
+        {"alu_r",        {0xa8}},             // xor b
+        {"alu_n",        {0xfe, 0x10}},       // cp 10
+        {"inc_rr",       {0x03}},             // inc bc
+        {"ld_r_hl",      {0x7e}},             // ld a,(hl)
+        {"ld_hl_r",      {0x77}},             // ld (hl),a
+        {"jr",           {0x18, 0x00}},       // jr +0
+        {"jr_not_taken", {0x20, 0x00}},       // jr nz,+0
+        {"call_ret",     {0xcd, kCallAddr & 0xff, kCallAddr >> 8}},
+        {"push_pop",     {0xc5, 0xc1}},       // push bc, pop bc
+        {"cb_swap",      {0xcb, 0x37}},       // swap a
+        {"cb_bit",       {0xcb, 0x47}},       // bit 0,a
+        {"cb_hl",        {0xcb, 0x16}}        // rl (hl)
+    };
+
+    for (const auto& instruction_class : classes) {
+        if (!run.is_selected(instruction_class.name)) {
+            continue;
+        }
+
+        GBMMU mmu;
+        GBCPU cpu(mmu);
+        cpu.unload_bios();
+        load_pattern(mmu, cpu, instruction_class.pattern);
+
+        run.measure(instruction_class.name, [&] {
+            bench_keep(cpu.step());
+        });
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * bench/gpu.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include "gpu.hpp"
+
+const int kSpriteCount = 40;
+
+// Tiles with varied pixels and a map that uses all of them
+static void load_tiles(GBMMU& mmu) {
+    uint32_t seed = 0x12345678;
+    for (auto& byte : mmu.vram) {
+        seed = seed * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(seed >> 16);
+    }
+    for (int i = 0; i < 0x400; i++) {
+        mmu.vram[0x1800 + i] = static_cast<uint8_t>(i);
+    }
+}
+
+// y and x of every sprite in OAM, 4 bytes each
+static void load_sprites(GBMMU& mmu, bool same_line) {
+    uint8_t* oam = mmu.get_oam_ram_head();
+    for (int i = 0; i < kSpriteCount; i++) {
+        oam[i * 4 + 0] = static_cast<uint8_t>(same_line ? 16 + 64 : 16 + i * 137 / kSpriteCount);
+        oam[i * 4 + 1] = static_cast<uint8_t>(8 + (i * 19) % 160);
+        oam[i * 4 + 2] = static_cast<uint8_t>(i);
+        oam[i * 4 + 3] = static_cast<uint8_t>((i & 3) << 4); // flips and palette
+    }
+}
+
+static void hide_sprites(GBMMU& mmu) {
+    uint8_t* oam = mmu.get_oam_ram_head();
+    for (int i = 0; i < kSpriteCount; i++) {
+        oam[i * 4 + 1] = 0;
+    }
+}
+
+static GBRasterState raster_state(uint8_t lcdc) {
+    GBRasterState state = {};
+    state.lcdc = LCDC_FLAG_DISPLAY_ENABLE | LCDC_FLAG_BACKGROUND_WINDOW_TILE_DATA_SELECT | lcdc;
+    state.scy = 3;
+    state.scx = 5;
+    state.bgp = 0xe4;
+    state.obp0 = 0xe4;
+    state.obp1 = 0x1b;
+    return state;
+}
+
+// One operation is one scanline
+BENCHMARK("gpu/renderscan") {
+    struct LayerMix {
+        const char* name;
+        uint8_t lcdc;
+    };
+
+    const LayerMix mixes[] = {
+        {"off",           0},
+        {"bg",            LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE},
+        {"sprites",       LCDC_FLAG_SPRITE_DISPLAY_ENABLE},
+        {"bg_sprites",    LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE | LCDC_FLAG_SPRITE_DISPLAY_ENABLE},
+        {"bg_sprites_8x16", LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE | LCDC_FLAG_SPRITE_DISPLAY_ENABLE |
+                          LCDC_FLAG_SPRITE_SIZE}
+    };
+
+    GBMMU mmu;
+    GBGPU gpu(mmu);
+    load_tiles(mmu);
+    load_sprites(mmu, false);
+
+    for (const auto& mix : mixes) {
+        GBRasterState state = raster_state(mix.lcdc);
+        int line = 0;
+        run.measure(mix.name, [&] {
+            gpu.renderscan(line, state);
+            line = (line + 1) % kScreenHeight;
+        });
+    }
+}
+
+// Sprites alone, so the OAM scan and sorting dominate
+BENCHMARK("gpu/sprites") {
+    GBMMU mmu;
+    GBGPU gpu(mmu);
+    load_tiles(mmu);
+    GBRasterState state = raster_state(LCDC_FLAG_SPRITE_DISPLAY_ENABLE);
+
+    hide_sprites(mmu);
+    run.measure("offscreen", [&] {
+        gpu.renderscan(64, state);
+    });
+
+    load_sprites(mmu, false);
+    int line = 0;
+    run.measure("spread", [&] {
+        gpu.renderscan(line, state);
+        line = (line + 1) % kScreenHeight;
+    });
+
+    load_sprites(mmu, true);
+    run.measure("all_on_line", [&] {
+        gpu.renderscan(64, state);
+    });
+}
@@ -0,0 +1,152 @@
+/*
+ * bench/main.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+#include "cartridge.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+volatile uint32_t bench_sink = 0;
+
+static std::vector<std::pair<std::string, BenchFunction>>& registry() {
+    static std::vector<std::pair<std::string, BenchFunction>> groups;
+    return groups;
+}
+
+BenchRegistration::BenchRegistration(const char* group, BenchFunction function) {
+    registry().push_back(std::make_pair(std::string(group), function));
+}
+
+bool BenchRun::is_selected(const std::string& variant) const {
+    return (group + "/" + variant).find(options.filter) != std::string::npos;
+}
+
+std::unique_ptr<GBCartridge> make_bench_cartridge(uint8_t cartridge_type, uint8_t rom_type, uint8_t ram_type) {
+    const size_t kBankSize = 0x4000;
+    const size_t banks = 2u << rom_type;
+    const std::string filename = "gb_bench_rom.gb";
+
+    std::vector<char> rom(banks * kBankSize);
+    for (size_t i = 0; i < rom.size(); i++) {
+        rom[i] = static_cast<char>(i / kBankSize);
+    }
+    rom[0x147] = static_cast<char>(cartridge_type);
+    rom[0x148] = static_cast<char>(rom_type);
+    rom[0x149] = static_cast<char>(ram_type);
+
+    {
+        std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
+        file.write(rom.data(), rom.size());
+    }
+
+    std::unique_ptr<GBCartridge> cartridge(new GBCartridge());
+    cartridge->load(filename.c_str());
+    std::remove(filename.c_str());
+    return cartridge;
+}
+
+// nearest rank on sorted samples
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void BenchRun::add_result(const std::string& variant, uint64_t ops_per_sample, std::vector<double>& samples) {
+    BenchResult result;
+    result.name = group + "/" + variant;
+    result.ops_per_sample = ops_per_sample;
+    result.samples = samples;
+
+    std::sort(samples.begin(), samples.end());
+    result.min = samples.front();
+    result.p10 = percentile(samples, 10);
+    result.median = percentile(samples, 50);
+    result.p90 = percentile(samples, 90);
+    result.max = samples.back();
+    results.push_back(result);
+
+    std::cerr << std::left << std::setw(40) << result.name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << result.median << " ns/op"
+              << "  (p10 " << result.p10 << ", p90 " << result.p90 << ")\n";
+}
+
+void write_bench_json(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results) {
+    out << std::setprecision(4) << std::fixed;
+    out << "{\n";
+    out << "  \"context\": {\"repetitions\": " << options.repetitions
+        << ", \"warmup\": " << options.warmup
+        << ", \"min_sample_ms\": " << options.min_sample_millis << "},\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        out << "    {\"name\": \"" << result.name << "\""
+            << ", \"ops_per_sample\": " << result.ops_per_sample
+            << ", \"samples\": " << result.samples.size()
+            << ", \"ns_per_op\": {\"min\": " << result.min
+            << ", \"p10\": " << result.p10
+            << ", \"median\": " << result.median
+            << ", \"p90\": " << result.p90
+            << ", \"max\": " << result.max << "}}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+void usage(const char* program) {
+    std::cout << "usage:\n";
+    std::cout << program << " [filter] [--json file] [--repetitions n] [--warmup n] [--min-time ms]\n";
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::string json_filename;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            json_filename = argv[++i];
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            options.repetitions = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            options.warmup = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            options.min_sample_millis = std::strtod(argv[++i], nullptr);
+        } else if (arg.compare(0, 2, "--") == 0 || !options.filter.empty()) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            options.filter = arg;
+        }
+    }
+
+    // registration order depends on the link order
+    std::sort(registry().begin(), registry().end());
+
+    std::vector<BenchResult> results;
+    for (const auto& group : registry()) {
+        BenchRun run(group.first, options, results);
+        group.second(run);
+    }
+
+    if (json_filename.empty()) {
+        write_bench_json(std::cout, options, results);
+        return 0;
+    }
+
+    std::ofstream json(json_filename);
+    write_bench_json(json, options, results);
+    if (!json) {
+        std::cerr << "error: could not write " << json_filename << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * bench/mbc.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include "mmu.hpp"
+
+const uint32_t kBankCount = 32;
+
+// MBC1 is the only controller with banking implemented
+BENCHMARK("mbc") {
+    MBC1 mbc(kBankCount, 0);
+    uint32_t bank = 0;
+    run.measure("mbc1/switch", [&] {
+        mbc.write(0x2000, static_cast<uint8_t>(1 + bank++ % (kBankCount - 1)));
+    });
+
+    uint16_t offset = 0;
+    run.measure("mbc1/translate", [&] {
+        bench_keep(mbc.translate_address(0x4000 + (offset++ & 0x3fff)));
+    });
+
+    // a switch followed by a read from the new bank, through the MMU
+    std::unique_ptr<GBCartridge> cartridge = make_bench_cartridge(CARTRIDGE_ROM_MBC1, 4);
+    GBMMU mmu(cartridge);
+    mmu.bios_loaded = false;
+    run.measure("mmu/switch_and_read", [&] {
+        mmu.write_byte(0x2000, static_cast<uint8_t>(1 + bank++ % (kBankCount - 1)));
+        bench_keep(mmu.read_byte(0x4000 + (offset++ & 0x3fff)));
+    });
+}
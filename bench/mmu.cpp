@@ -0,0 +1,62 @@
+/*
+ * bench/mmu.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include "mmu.hpp"
+
+struct MemoryRegion {
+    const char* name;
+    uint16_t base;
+    uint16_t size;
+};
+
+// sizes are powers of two so addresses wrap with a mask
+const MemoryRegion kReadRegions[] = {
+    {"rom0", 0x0000, 0x4000},
+    {"romx", 0x4000, 0x4000},
+    {"vram", 0x8000, 0x2000},
+    {"wram", 0xc000, 0x2000},
+    {"oam",  0xfe00, 0x0080},
+    {"io",   0xff40, 0x0008},
+    {"hram", 0xff80, 0x0040}
+};
+
+// ROM writes are MBC commands, see the mbc group
+const MemoryRegion kWriteRegions[] = {
+    {"vram", 0x8000, 0x2000},
+    {"wram", 0xc000, 0x2000},
+    {"oam",  0xfe00, 0x0080},
+    {"io",   0xff47, 0x0001}, // bgp, no side effects
+    {"hram", 0xff80, 0x0040}
+};
+
+BENCHMARK("mmu/read_byte") {
+    std::unique_ptr<GBCartridge> cartridge = make_bench_cartridge(CARTRIDGE_ROM, 0);
+    GBMMU mmu(cartridge);
+    mmu.bios_loaded = false;
+
+    for (const auto& region : kReadRegions) {
+        uint16_t offset = 0;
+        run.measure(region.name, [&] {
+            bench_keep(mmu.read_byte(region.base + (offset++ & (region.size - 1))));
+        });
+    }
+}
+
+BENCHMARK("mmu/write_byte") {
+    GBMMU mmu;
+    mmu.bios_loaded = false;
+
+    for (const auto& region : kWriteRegions) {
+        uint16_t offset = 0;
+        run.measure(region.name, [&] {
+            mmu.write_byte(region.base + (offset & (region.size - 1)), static_cast<uint8_t>(offset));
+            offset++;
+        });
+    }
+}
@@ -0,0 +1,31 @@
+/*
+ * bench/save_state.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include "save_state.hpp"
+
+// One operation is one whole machine state, with 32kB cartridge RAM
+BENCHMARK("save_state") {
+    std::unique_ptr<GBCartridge> cartridge = make_bench_cartridge(CARTRIDGE_ROM_MBC1_RAM, 4, 3);
+    GBMMU mmu(cartridge);
+    GBCPU cpu(mmu);
+    GBGPU gpu(mmu);
+    cpu.unload_bios();
+
+    std::vector<uint8_t> buffer;
+    run.measure("save", [&] {
+        save_state(cpu, gpu, buffer);
+        bench_keep(buffer.size());
+    });
+
+    std::vector<uint8_t> state = buffer;
+    std::string error;
+    run.measure("load", [&] {
+        bench_keep(load_state(cpu, gpu, state.data(), state.size(), error));
+    });
+}
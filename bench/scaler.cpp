@@ -0,0 +1,61 @@
+/*
+ * bench/scaler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "bench.hpp"
+
+#include "scaler.hpp"
+
+// A frame with runs of equal shades and edges between them, so Scale2x
+// and Scale3x take both their copy and their interpolation paths
+static std::vector<uint32_t> make_frame() {
+    std::vector<uint8_t> shades(kScreenSize);
+    uint32_t seed = 0x12345678;
+    for (int i = 0; i < kScreenSize; i++) {
+        if (i % 5 == 0) {
+            seed = seed * 1103515245 + 12345;
+        }
+        shades[i] = static_cast<uint8_t>((seed >> 16) & 0x3);
+    }
+
+    std::vector<uint32_t> pixels(kScreenSize);
+    expand_shades(shades.data(), pixels.data(), kScreenSize);
+    return pixels;
+}
+
+// One operation is one full 160x144 frame, scaled on the calling thread
+// alone and split in bands over four threads
+static void measure_filter(BenchRun& run, ScaleFilter filter, int factor, const std::string& prefix) {
+    std::vector<uint32_t> frame = make_frame();
+
+    const int thread_counts[] = {1, 4};
+    for (int threads : thread_counts) {
+        Scaler scaler(filter, factor, threads);
+        std::vector<uint32_t> output(scaler.get_output_width() * scaler.get_output_height());
+        int pitch = scaler.get_output_width() * sizeof(uint32_t);
+
+        std::string name = prefix + (threads == 1 ? "" : "_threads" + std::to_string(threads));
+        run.measure(name, [&] {
+            scaler.scale(frame.data(), output.data(), pitch);
+            bench_keep(output[output.size() / 2]);
+        });
+    }
+}
+
+BENCHMARK("scaler/nearest") {
+    const int factors[] = {2, 3, 4};
+    for (int factor : factors) {
+        measure_filter(run, SCALE_NEAREST, factor, std::to_string(factor) + "x");
+    }
+}
+
+BENCHMARK("scaler/scale2x") {
+    measure_filter(run, SCALE_2X, 2, "frame");
+}
+
+BENCHMARK("scaler/scale3x") {
+    measure_filter(run, SCALE_3X, 3, "frame");
+}
@@ -0,0 +1,153 @@
+#ifndef BREAKPOINTS_HPP
+#define BREAKPOINTS_HPP
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "mmu.hpp"
+
+enum BreakKind : uint8_t {
+    BREAK_EXECUTE = (1 << 0),
+    BREAK_READ    = (1 << 1),
+    BREAK_WRITE   = (1 << 2)
+};
+
+// Condition attached to a breakpoint, compiled once from text such as
+//
+//   a == 0x10 && hl >= 0xc000 && value != 0 && [ff44] == 144
+//
+// into a list of comparisons that are all required to hold. Operands are
+// the registers, value (the byte read or written) and [addr], numbers are
+// decimal or 0x prefixed hex.
+class BreakCondition {
+private:
+    enum Operand : uint8_t {
+        OPERAND_A, OPERAND_F, OPERAND_B, OPERAND_C, OPERAND_D, OPERAND_E,
+        OPERAND_H, OPERAND_L, OPERAND_AF, OPERAND_BC, OPERAND_DE, OPERAND_HL,
+        OPERAND_SP, OPERAND_PC, OPERAND_VALUE, OPERAND_MEMORY
+    };
+
+    enum Compare : uint8_t {
+        COMPARE_EQ, COMPARE_NE, COMPARE_LT, COMPARE_LE, COMPARE_GT, COMPARE_GE
+    };
+
+    struct Term {
+        Operand operand;
+        Compare compare;
+        uint16_t address; // for OPERAND_MEMORY
+        uint16_t value;
+    };
+
+    std::vector<Term> terms;
+
+public:
+    // Empty text compiles to a condition that always holds
+    static bool compile(const std::string& text, BreakCondition& condition, std::string& error);
+
+    bool empty() const { return terms.empty(); }
+
+    bool evaluate(const GBCPU& cpu, uint8_t value) const;
+};
+
+struct Breakpoint {
+    uint32_t id;
+    uint8_t kinds;
+    uint16_t first;
+    uint16_t last;
+    BreakCondition condition;
+    std::string text;
+    uint64_t hits;
+};
+
+struct BreakHit {
+    uint32_t id;
+    BreakKind kind;
+    uint16_t addr;
+    uint8_t value;
+};
+
+// Execute breakpoints and read/write watchpoints.
+//
+// Armed addresses are kept in one bitmap per kind, and a per-page summary
+// tells which 256 byte pages hold any of them. Only pages with a read or
+// write watchpoint are routed to this observer by the MMU, every other
+// access takes the plain path. With nothing armed the MMU has no observer
+// and check() is a single predictable branch per instruction. An observer
+// already installed, e.g. a memory trace, is kept and sees every access
+// it saw before, forwarded from here while watchpoints are set.
+class GBBreakpoints : public GBMemoryObserver {
+private:
+    GBCPU& cpu;
+    GBMMU& mmu;
+
+    std::vector<Breakpoint> breakpoints;
+    uint32_t next_id;
+
+    std::bitset<0x10000> execute_addrs;
+    std::bitset<0x10000> read_addrs;
+    std::bitset<0x10000> write_addrs;
+    std::array<uint8_t, kMemoryPageCount> page_kinds;
+
+    bool armed;
+    bool observing;   // installed as the mmu memory observer
+
+    // the observer installed before, with the pages it observed
+    GBMemoryObserver* chained;
+    std::array<bool, kMemoryPageCount> chained_pages;
+    bool hit_pending; // a watchpoint fired during the last instruction
+    bool resuming;    // let the instruction stopped at run once
+    BreakHit hit;
+
+    void rebuild();
+    bool match(BreakKind kind, uint16_t addr, uint8_t value);
+
+    bool check_armed(uint16_t pc) {
+        if (resuming) {
+            resuming = false;
+            return false;
+        }
+        if (hit_pending) {
+            hit_pending = false;
+            return true;
+        }
+        return (page_kinds[pc >> 8] & BREAK_EXECUTE) && execute_addrs[pc]
+            && match(BREAK_EXECUTE, pc, 0);
+    }
+
+public:
+    GBBreakpoints(GBCPU& cpu);
+    GBBreakpoints(const GBBreakpoints&) = delete;
+    ~GBBreakpoints();
+
+    // Adds "<kinds> <addr>[-<addr>] [if <condition>]", kinds being any of
+    // x, r and w and addresses hex, e.g. "x 0150" or "w c000-c0ff if
+    // value == 0". Returns the id, or 0 and the reason in error.
+    uint32_t add(const std::string& spec, std::string& error);
+    uint32_t add(uint8_t kinds, uint16_t first, uint16_t last, const BreakCondition& condition);
+    bool remove(uint32_t id);
+    void clear();
+
+    const std::vector<Breakpoint>& get_breakpoints() const { return breakpoints; }
+    bool is_armed() const { return armed; }
+
+    // Called before every instruction, true when execution should stop
+    // before the instruction at pc. get_hit() tells which breakpoint.
+    bool check(uint16_t pc) {
+        return armed && check_armed(pc);
+    }
+
+    // Continues after a hit without stopping again at the same instruction
+    void resume() { resuming = true; }
+
+    const BreakHit& get_hit() const { return hit; }
+    std::string describe(const BreakHit& hit) const;
+
+    virtual void memory_read(uint16_t addr, uint8_t value) override;
+    virtual void memory_write(uint16_t addr, uint8_t value) override;
+};
+
+#endif
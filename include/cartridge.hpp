@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <fstream>
 #include <memory.h>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -78,9 +79,19 @@ public:
 
     uint8_t read(uint16_t addr) const;
 
+    // Bank mapped at 0x4000-0x7fff, and reads from any bank without
+    // switching it, for tools that look at code in other banks
+    uint32_t get_rom_bank() const;
+    uint8_t read_rom_bank(uint32_t bank, uint16_t addr) const;
+
     void dma_read(uint16_t addr, uint16_t length, std::vector<uint8_t>::iterator dst);
 
     void write(uint16_t addr, uint8_t value);
+
+    // Controller registers and RAM. Loading fails for a state saved with a
+    // different ROM.
+    void save_state(GBStateWriter& writer) const;
+    void load_state(GBStateReader& reader);
 };
 
 #endif
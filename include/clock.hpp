@@ -7,4 +7,7 @@ typedef uint32_t tick_t;
 
 const tick_t kTicksPerSecond = 4194304;
 
+// 154 lines of 456 ticks, the real LCD refresh is ~59.73 Hz
+const tick_t kTicksPerLcdFrame = 70224;
+
 #endif
@@ -7,6 +7,7 @@
 
 #include "clock.hpp"
 #include "mmu.hpp"
+#include "opcode_profile.hpp"
 
 class Registers {
 public:
@@ -74,6 +75,14 @@ public:
     GBCPU(const GBCPU&) = delete;
 
     void reset();
+    void unload_bios();
+
+    tick_t step();
+    tick_t service_interrupts();
+
+    // Registers, interrupt enable lives in GBMMU
+    void save_state(GBStateWriter& writer) const;
+    void load_state(GBStateReader& reader);
 
     // Common Instruction Behavior
     tick_t ld_r_r   (uint8_t&  dst_reg,  uint8_t  src_reg);
@@ -139,7 +148,14 @@ public:
 
     tick_t cb_branch() {
         uint8_t op = mmu.read_byte(reg.pc++);
+#ifdef GB_OPCODE_PROFILE
+        uint64_t start = read_host_cycles();
+        tick_t t = (*this.*cb_instruction_map.at(op))();
+        OpcodeProfile::global().add(true, op, read_host_cycles() - start, t);
+        return t;
+#else
         return (*this.*cb_instruction_map.at(op))();
+#endif
     }
 
     // Instruction Set
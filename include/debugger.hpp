@@ -3,14 +3,40 @@
 
 #include <SDL.h>
 #include <SDL_ttf.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <sstream>
-#include <queue>
+#include <thread>
 
 #include "cpu.hpp"
 #include "gpu.hpp"
 #include "mmu.hpp"
 #include "joypad.hpp"
 #include "instruction.hpp"
+#include "glyph_atlas.hpp"
+#include "ring_buffer.hpp"
+#include "triple_buffer.hpp"
+
+const size_t kDebuggerHistorySize = 32;
+const size_t kDebuggerMemorySize  = 256;
+
+// Copy of the state shown by the debugger, taken by the emulation thread
+// and formatted on the UI thread
+struct DebugSnapshot {
+    Registers reg;
+    uint8_t iram[kDebuggerMemorySize];
+
+    struct Executed {
+        uint16_t pc;
+        uint8_t bytes[3];
+    };
+    Executed history[kDebuggerHistorySize];
+    size_t history_size;
+
+    uint64_t number;
+};
 
 class Debugger {
 private:
@@ -19,23 +45,64 @@ private:
     GBMMU& mmu;
     GBJoypad& joypad;
 
-    SDL_Window*   window;
+    SDL_Window* window;
+
+    // Raw pc and rom bank of the last instructions, decoded only when a
+    // snapshot is taken
+    struct HistoryEntry {
+        uint16_t pc;
+        uint16_t bank;
+    };
+    RingBuffer<HistoryEntry, kDebuggerHistorySize> history;
+
+    // The emulation thread only copies state into the mailbox, the UI
+    // thread owns the renderer and does all formatting and drawing at its
+    // own refresh rate.
+    TripleBuffer<DebugSnapshot> snapshots;
+    uint64_t snapshot_count;
+
+    std::thread ui_thread;
+    std::atomic<bool> running;
+    std::mutex ui_mutex;
+    std::condition_variable ui_signal;
+
+    // owned by the ui thread
     SDL_Renderer* renderer;
     TTF_Font*     font;
 
-    std::queue<Instruction> last_cpu_instructions;
+    // Text is drawn from the atlas into canvas, which keeps the previous
+    // frame so only lines that differ from drawn_lines are redrawn.
+    std::unique_ptr<GlyphAtlas> atlas;
+    SDL_Texture* canvas;
+    std::vector<std::string> drawn_lines;
+
+    void ui_loop();
+    void draw(const DebugSnapshot& snapshot);
 
-    std::vector<std::string> dump_registers();
-    std::vector<std::string> dump_memory();
-    std::vector<std::string> dump_executed_instructions();
+    std::vector<std::string> dump_registers(const Registers& reg);
+    std::vector<std::string> dump_memory(const DebugSnapshot& snapshot);
+    std::vector<std::string> dump_executed_instructions(const DebugSnapshot& snapshot);
 
 public:
     Debugger(GBCPU& cpu, GBGPU& gpu, GBJoypad& joypad);
+    Debugger(const Debugger&) = delete;
+    ~Debugger();
+
     void show();
     void hide();
-    void draw();
 
-    void log_instruction();
+    // Hands the current state to the UI thread, called once per frame
+    void publish_snapshot();
+
+    // Called before every instruction. Costs one branch while the window
+    // is closed, building with -DGB_NO_INSTRUCTION_HISTORY removes it.
+    void log_instruction() {
+#ifndef GB_NO_INSTRUCTION_HISTORY
+        if (window) {
+            history.push(HistoryEntry{cpu.reg.pc, static_cast<uint16_t>(mmu.get_rom_bank())});
+        }
+#endif
+    }
 };
 
 #endif
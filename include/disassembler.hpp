@@ -0,0 +1,115 @@
+#ifndef DISASSEMBLER_HPP
+#define DISASSEMBLER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+const uint16_t kRomBankSize = 0x4000;
+
+// What is known about a ROM byte
+enum CodeFlag : uint8_t {
+    CODE_OPCODE      = (1 << 0), // first byte of an instruction
+    CODE_OPERAND     = (1 << 1), // other bytes of an instruction
+    CODE_ENTRY       = (1 << 2), // start, rst or interrupt vector
+    CODE_JUMP_TARGET = (1 << 3),
+    CODE_CALL_TARGET = (1 << 4),
+    CODE_TABLE       = (1 << 5)  // first byte of a jump table entry
+};
+
+enum EdgeKind : uint8_t {
+    EDGE_JUMP,   // unconditional jp/jr
+    EDGE_BRANCH, // conditional jp/jr
+    EDGE_CALL,   // call and rst
+    EDGE_TABLE   // jump table entry
+};
+
+struct CodeEdge {
+    uint16_t from;
+    uint16_t to_bank;
+    uint16_t to;
+    EdgeKind kind;
+};
+
+const uint32_t kCodeMapVersion = 1;
+const char kCodeMapMagic[8] = {'G', 'B', 'C', 'O', 'D', 'E', 'M', '\0'};
+
+// One CodeFlag byte per ROM byte. Bank 0 covers 0x0000-0x3fff, the other
+// banks 0x4000-0x7fff, addresses are the ones the CPU sees.
+class GBCodeMap {
+private:
+    std::vector<std::vector<uint8_t>> banks;
+
+public:
+    GBCodeMap(uint32_t bank_count = 0);
+
+    uint32_t get_bank_count() const { return banks.size(); }
+
+    uint8_t get(uint32_t bank, uint16_t addr) const { return banks[bank][addr & (kRomBankSize - 1)]; }
+    uint8_t& at(uint32_t bank, uint16_t addr) { return banks[bank][addr & (kRomBankSize - 1)]; }
+
+    // Bytes in all banks with any of the flags set
+    size_t count(uint8_t flags) const;
+
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+    bool operator==(const GBCodeMap& other) const { return banks == other.banks; }
+};
+
+// Static disassembler for whole ROMs.
+//
+// Code is found by following jumps, calls and rst jump tables from the
+// start and vector addresses. Each bank is walked by one worker that only
+// touches its own part of the code map, targets in other banks are handed
+// over between rounds, so banks are analyzed in parallel without locks
+// and the result doesn't depend on the thread count.
+//
+// Jumps from bank 0 into 0x4000-0x7fff are resolved when the code just
+// wrote a constant bank number to the MBC, or when the ROM has a single
+// switchable bank; the others are counted as unresolved.
+class GBDisassembler {
+private:
+    struct Target {
+        uint32_t bank;
+        uint16_t addr;
+        uint8_t flag;
+    };
+
+    const std::vector<uint8_t>& rom;
+    uint32_t bank_count;
+
+    GBCodeMap code_map;
+    std::vector<std::vector<CodeEdge>> edges;
+    std::vector<uint32_t> unresolved;
+
+    uint8_t read(uint32_t bank, uint16_t addr) const;
+    bool in_bank(uint32_t bank, uint32_t addr) const;
+    bool is_table_dispatcher(uint16_t addr) const;
+
+    void analyze_bank(uint32_t bank, std::vector<uint16_t> pending, std::vector<Target>& far);
+
+    // Instruction starts of a bank that begin a basic block
+    std::vector<bool> find_leaders(uint32_t bank) const;
+
+public:
+    GBDisassembler(const std::vector<uint8_t>& rom);
+    GBDisassembler(const GBDisassembler&) = delete;
+
+    void analyze(unsigned threads);
+
+    uint32_t get_bank_count() const { return bank_count; }
+    const GBCodeMap& get_code_map() const { return code_map; }
+    const std::vector<CodeEdge>& get_edges(uint32_t bank) const { return edges[bank]; }
+    uint32_t get_unresolved_count() const;
+
+    // Annotated listing of every bank, code as instructions and the rest
+    // as data
+    void write_disassembly(std::ostream& out) const;
+
+    // Graphviz graph of the basic blocks
+    void write_cfg(std::ostream& out) const;
+};
+
+#endif
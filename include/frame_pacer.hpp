@@ -0,0 +1,93 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "clock.hpp"
+
+enum PacingMode {
+    PACE_REALTIME, // one frame every 70224 ticks of real time, ~59.73 Hz
+    PACE_VSYNC,    // one frame per display refresh, see vsync()
+    PACE_UNCAPPED  // as fast as the host runs
+};
+
+bool parse_pacing_mode(const std::string& name, PacingMode& mode);
+
+// Paces emulated frames against the host clock.
+//
+// Deadlines are absolute points on steady_clock, one frame duration
+// apart, so the time spent emulating is part of the frame and errors
+// don't add up. Waiting sleeps until shortly before the deadline and
+// spins the rest, the spin margin follows how late the OS wakes us. When
+// emulation falls more than a few frames behind, the deadline restarts
+// from now instead of running frames back to back to catch up.
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    PacingMode mode;
+    double speed;
+    Clock::duration lcd_frame_duration;
+    Clock::duration frame_duration;
+    Clock::time_point deadline;
+    Clock::duration spin_margin;
+    bool started;
+    bool paused;
+
+    uint64_t frame_count;
+    uint64_t late_frames;
+
+    // achieved speed over the last measure window
+    Clock::time_point window_start;
+    uint64_t window_frames;
+    double measured_speed;
+
+    // display refreshes counted by vsync(), waited on in PACE_VSYNC
+    std::mutex vsync_mutex;
+    std::condition_variable vsync_signal;
+    uint64_t vsync_count;
+    uint64_t vsync_seen;
+
+    void wait_deadline();
+    void wait_vsync();
+    void measure();
+
+public:
+    FramePacer(PacingMode mode = PACE_REALTIME, tick_t ticks_per_frame = kTicksPerLcdFrame);
+    FramePacer(const FramePacer&) = delete;
+
+    PacingMode get_mode() const { return mode; }
+    void set_mode(PacingMode mode);
+
+    // Multiple of the hardware rate frames are paced at, 0 or less is
+    // unlimited. Only 1x locks to vsync, other speeds go by the clock.
+    void set_speed(double speed);
+    double get_speed() const { return speed; }
+
+    Clock::duration get_frame_duration() const { return frame_duration; }
+
+    // Blocks until the current frame's time is up
+    void wait_frame();
+
+    // While paused wait_frame() doesn't wait, the caller is expected to
+    // block on its own events. resume() starts counting time afresh.
+    void pause();
+    void resume();
+    bool is_paused() const { return paused; }
+
+    // Called by the thread that presents, after each display refresh
+    void vsync();
+
+    uint64_t get_frame_count() const { return frame_count; }
+    uint64_t get_late_frames() const { return late_frames; }
+
+    // Emulated time over wall time, updated about once a second
+    double get_measured_speed() const { return measured_speed; }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+const int kScreenWidth  = 160;
+const int kScreenHeight = 144;
+const int kScreenSize   = kScreenWidth * kScreenHeight;
+
+// DMG shades as ARGB8888: white, light gray, dark gray and black
+const uint32_t kShadePalette[4] = {0xFF9BBC0F, 0xFF8BAC0F, 0xFF306230, 0xFF0f380f};
+
+// Converts shade indices to ARGB8888 through kShadePalette
+void expand_shades(const uint8_t* shades, uint32_t* pixels, int count);
+
+// Finds the first and last rows where two frames of shade indices differ.
+// Returns false, leaving the rows untouched, when the frames are equal.
+bool find_changed_rows(const uint8_t* previous, const uint8_t* shades,
+        int& first_row, int& last_row);
+
+// Receives every frame completed by GBGPU as one shade index (0-3) per
+// pixel, kScreenWidth x kScreenHeight. Sinks that display or store the
+// frame in color expand it themselves.
+//
+// The timestamp is the emulated time, in ticks since power on, at which
+// the frame was completed. Skipped, reused or LCD-off frames aren't
+// presented, so only the timestamp tells how far apart two frames are.
+class FrameSink {
+public:
+    virtual ~FrameSink() {}
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) = 0;
+};
+
+// Discards frames, for running at uncapped speed
+class NullFrameSink : public FrameSink {
+public:
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override {}
+};
+
+// Keeps a copy of the last frame (shade indices) for programmatic access,
+// frames are passed on to the next sink, if any
+class MemoryFrameSink : public FrameSink {
+private:
+    std::vector<uint8_t> frame;
+    uint64_t frame_count;
+    uint64_t timestamp;
+    FrameSink* next;
+
+public:
+    MemoryFrameSink(FrameSink* next = nullptr);
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override;
+
+    const std::vector<uint8_t>& get_frame() const { return frame; }
+    uint64_t get_frame_count() const { return frame_count; }
+    uint64_t get_timestamp() const { return timestamp; }
+};
+
+// Appends every frame to a file as a binary PPM (P6) stream
+class FileFrameSink : public FrameSink {
+private:
+    std::ofstream file;
+    std::vector<uint8_t> rgb;
+
+public:
+    FileFrameSink(const std::string& filename);
+
+    bool is_open() const { return file.is_open(); }
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override;
+};
+
+#endif
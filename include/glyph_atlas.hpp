@@ -0,0 +1,31 @@
+#ifndef GLYPH_ATLAS_HPP
+#define GLYPH_ATLAS_HPP
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <string>
+
+// Printable ASCII glyphs of a monospace font rendered once into a single
+// texture. Text is drawn as one SDL_RenderCopy per character from that
+// texture, which SDL batches, instead of rendering a surface per string.
+class GlyphAtlas {
+private:
+    SDL_Texture* texture;
+    int glyph_width;
+    int line_height;
+
+public:
+    GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font, SDL_Color foreground, SDL_Color background);
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    ~GlyphAtlas();
+
+    bool is_valid() const { return texture != nullptr; }
+
+    int get_glyph_width() const { return glyph_width; }
+    int get_line_height() const { return line_height; }
+
+    // Characters outside the atlas are drawn as blanks
+    void draw_text(SDL_Renderer* renderer, const std::string& text, int x, int y) const;
+};
+
+#endif
@@ -1,9 +1,9 @@
 #ifndef GPU_HPP
 #define GPU_HPP
 
-#include <SDL.h>
 #include <vector>
 
+#include "frame_sink.hpp"
 #include "mmu.hpp"
 #include "sprite.hpp"
 
@@ -25,23 +25,76 @@ enum LcdcFlags : uint8_t {
     LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE          = (1 << 0)
 };
 
-class GBGPU {
+// LCD registers that can be changed between scanlines (raster effects)
+struct GBRasterState {
+    uint8_t lcdc;
+    uint8_t scy;
+    uint8_t scx;
+    uint8_t bgp;
+    uint8_t obp0;
+    uint8_t obp1;
+    uint8_t wy;
+    uint8_t wx;
+};
+
+// Register write that takes effect starting on the given scanline
+struct GBRasterEvent {
+    uint8_t  line;
+    uint8_t  value;
+    uint16_t addr;
+};
+
+class GBGPU : public GBVideoObserver {
 private:
-    SDL_Window*   window;
-    SDL_Renderer* renderer;
-    SDL_Texture*  texture;
+    std::vector<uint8_t> framebuffer; // shade index (0-3) per pixel
 
-    std::vector<Uint32> framebuffer;
+    FrameSink* sink;
 
     tick_t clock;
-
-    std::string window_title;
+    uint64_t emulated_ticks; // stepped since power on, stamps the frames
+
+    // Ticks not yet applied to the PPU, and how many can accumulate before
+    // the next event that may raise an interrupt
+    tick_t pending_ticks;
+    tick_t sync_deadline;
+
+    // Scanlines are only latched during the frame (registers are logged) and
+    // rendered in one pass at vblank or before VRAM/OAM is overwritten.
+    bool frame_open;
+    int  latched_lines;
+    int  rendered_lines;
+
+    GBRasterState line_state;
+    std::vector<GBRasterEvent> raster_log;
+    size_t raster_log_cursor;
+
+    // Skipped frames keep LY/STAT timing and interrupts but draw nothing
+    uint32_t frame_skip;
+    uint32_t frame_counter;
+    bool frame_requested;
+    bool frame_rendering;
+
+    // Frames that still have to be rendered because VRAM, OAM or a raster
+    // register changed. A change after the first latched line leaves that
+    // frame mixed, so the following frame is dirty too. Clean frames reuse
+    // the previous framebuffer.
+    uint8_t dirty_frames;
+    uint64_t reused_frames;
 
     uint16_t decode_background_address(const uint8_t line, const uint8_t column);
 
     void clear_scanline(const int scanline);
-    void render_background_scanline(const int scanline);
-    void render_sprite_scanline(const int scanline);
+    void render_background_scanline(const int scanline, const GBRasterState& state);
+    void render_sprite_scanline(const int scanline, const GBRasterState& state);
+
+    tick_t ticks_to_next_mode() const;
+    tick_t ticks_to_line(uint8_t line) const;
+    tick_t ticks_to_next_event() const;
+
+    void open_frame();
+    void latch_scanline();
+    void render_latched_scanlines();
+    void mark_frame_dirty();
 
 public:
     GBMMU& mmu;
@@ -49,18 +102,39 @@ public:
     GBGPU(GBMMU&);
     ~GBGPU();
 
-    void show();
-    void hide();
+    GBRasterState get_raster_state() const;
 
-    void black();
-    void blank();
+    void set_frame_sink(FrameSink* sink);
 
-    void renderscan();
-    void refresh();
+    // Render one of every n frames, or only requested frames when n is 0
+    void set_frame_skip(uint32_t n);
+    void request_frame();
+
+    uint64_t get_reused_frames() const { return reused_frames; }
 
-    void step(uint8_t elapsed_ticks);
+    // Mode timing, the latched frame and the framebuffer. The frame sink
+    // and frame skip setting are left as they are.
+    void save_state(GBStateWriter& writer) const;
+    void load_state(GBStateReader& reader);
+
+    void renderscan(const int scanline, const GBRasterState& state);
+    void refresh();
 
-    void set_window_title(const std::string&);
+    void step(tick_t elapsed_ticks);
+
+    // Catch-up stepping: the PPU only advances when observed through the
+    // MMU or when the next interrupt is due, otherwise ticks accumulate
+    void tick(tick_t elapsed_ticks) {
+        pending_ticks += elapsed_ticks;
+        if (pending_ticks >= sync_deadline) {
+            sync();
+        }
+    }
+    void sync();
+
+    virtual void video_memory_write(uint16_t addr, uint8_t value) override;
+    virtual void lcd_register_write(uint16_t addr, uint8_t value) override;
+    virtual void lcd_register_read(uint16_t addr) override;
 };
 
 #endif
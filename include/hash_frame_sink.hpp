@@ -0,0 +1,47 @@
+#ifndef HASH_FRAME_SINK_HPP
+#define HASH_FRAME_SINK_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "cpu.hpp"
+#include "frame_sink.hpp"
+
+// Writes 64 bit hashes of the machine, one line per emulated frame:
+//
+//   <frame> <frame hash> <wram hash> <vram hash> <cpu hash>
+//
+// The frame hash is of the last presented frame. The runner calls
+// write_frame() once per emulated frame, so frames that are skipped,
+// reused or not drawn at all with the LCD off still get their line and
+// the memory and CPU hashes keep checking the emulation. The cpu hash
+// covers the registers, HRAM and the interrupt state. The memory and cpu
+// hashes are only written when a GBCPU is given. Frames are passed on to
+// the next sink, if any, so hashing can stay on while recording or
+// displaying.
+class HashFrameSink : public FrameSink {
+private:
+    std::ofstream file;
+    const GBCPU* cpu;
+    FrameSink* next;
+    uint64_t frames_written;
+    uint64_t frames_presented;
+    uint64_t last_hash;
+
+public:
+    HashFrameSink(const std::string& filename, const GBCPU* cpu = nullptr, FrameSink* next = nullptr);
+
+    bool is_open() const { return file.is_open(); }
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override;
+
+    // Writes the line of the emulated frame that just ended
+    void write_frame();
+
+    uint64_t get_frames_written() const { return frames_written; }
+    uint64_t get_frames_presented() const { return frames_presented; }
+    uint64_t get_last_hash() const { return last_hash; }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef INPUT_SCRIPT_HPP
+#define INPUT_SCRIPT_HPP
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Joypad bits as given to GBMMU::set_joypad_state, a cleared bit is a
+// pressed key
+enum JoypadKey : uint8_t {
+    JOYPAD_RIGHT  = (1 << 0),
+    JOYPAD_LEFT   = (1 << 1),
+    JOYPAD_UP     = (1 << 2),
+    JOYPAD_DOWN   = (1 << 3),
+    JOYPAD_A      = (1 << 4),
+    JOYPAD_B      = (1 << 5),
+    JOYPAD_SELECT = (1 << 6),
+    JOYPAD_START  = (1 << 7)
+};
+
+const uint8_t kJoypadReleased = 0xff;
+
+// Scripted joypad input for deterministic runs.
+//
+// One change per line, the keys held from that frame on:
+//
+//   # frame  keys
+//   120      start
+//   130      -
+//   300      a+left
+//
+// Keys are up, down, left, right, a, b, select and start joined by '+',
+// '-' releases everything. Lines must be in frame order, '#' starts a
+// comment.
+class GBInputScript {
+private:
+    struct Change {
+        uint64_t frame;
+        uint8_t state;
+    };
+
+    std::vector<Change> changes;
+    size_t cursor;
+
+public:
+    GBInputScript();
+
+    bool load(const std::string& filename);
+    bool parse(std::istream& input, std::string& error);
+
+    // Joypad state for frame, frames must be asked in increasing order
+    uint8_t state_at(uint64_t frame);
+
+    bool empty() const { return changes.empty(); }
+};
+
+#endif
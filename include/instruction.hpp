@@ -18,7 +18,20 @@ public:
         : address(address), opcode(opcode), arg0(arg0), arg1(arg1) {
     }
 
-    std::string to_string();
+    // "addr: assembly", as shown by the debugger
+    std::string to_string() const;
+    std::string to_assembly() const;
+
+    // Instruction with its operands as n, nn and e, e.g. "ld a,$n"
+    static std::string mnemonic(uint8_t opcode);
+
+    // Name of the instruction that follows a 0xcb prefix
+    static std::string cb_name(uint8_t opcode);
+
+    // Bytes taken by the instruction, 0xcb prefixed ones included
+    static uint8_t length(uint8_t opcode) {
+        return (opcode == 0xcb) ? 2 : kInstrunctionLength[opcode];
+    }
 };
 
 #endif
@@ -1,20 +1,22 @@
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <thread>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include "cpu.hpp"
 #include "gpu.hpp"
 #include "mmu.hpp"
 #include "joypad.hpp"
+#include "frame_pacer.hpp"
+#include "speed_control.hpp"
+#include "sdl_frame_sink.hpp"
 
+#include "breakpoints.hpp"
 #include "debugger.hpp"
 
 #include "instruction.hpp"
 
-const Uint32 kFramesPerSecond = 60;
-const Uint32 kMillisPerFrame  = 1000 / kFramesPerSecond;
-
-const tick_t kTicksPerFrame  = kTicksPerSecond / kFramesPerSecond;
-
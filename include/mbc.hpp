@@ -3,6 +3,8 @@
 
 #include <cstdint>
 
+#include "state_buffer.hpp"
+
 class MBC {
 protected:
     const uint32_t rom_bank_count;
@@ -12,6 +14,13 @@ protected:
     uint32_t ram_bank_number;
 
     bool ram_enabled;
+
+    // Reads what save_state() wrote, load_state() then checks the banks
+    virtual void read_state(GBStateReader& reader);
+
+    // Whether the mapped banks exist, cartridges without a controller
+    // have no bank counts
+    virtual bool banks_in_range() const;
 public:
     MBC(uint32_t rom_bank_count, uint32_t ram_bank_count);
     virtual ~MBC() {}
@@ -19,18 +28,32 @@ public:
     virtual uint32_t translate_address(uint16_t addr);
     virtual void write(uint16_t addr, uint8_t value);
     virtual bool is_ram_enabled() { return ram_enabled; }
+
+    // Bank mapped at 0x4000-0x7fff
+    virtual uint32_t get_rom_bank() const { return rom_bank_number; }
+
+    // Bank registers, controllers with more state extend them
+    virtual void save_state(GBStateWriter& writer) const;
+    void load_state(GBStateReader& reader);
 };
 
 class MBC1 : public MBC {
 private:
     bool is_ram_banking_mode;
 
+protected:
+    virtual void read_state(GBStateReader& reader) override;
+    virtual bool banks_in_range() const override;
+
 public:
     MBC1(uint32_t rom_bank_count, uint32_t ram_bank_count);
     virtual ~MBC1() override {};
 
     virtual uint32_t translate_address(uint16_t addr) override;
     virtual void write(uint16_t addr, uint8_t value) override;
+    virtual uint32_t get_rom_bank() const override;
+
+    virtual void save_state(GBStateWriter& writer) const override;
 };
 
 class MBC2 : public MBC {
@@ -3,8 +3,10 @@
 
 #include "clock.hpp"
 #include "cartridge.hpp"
+#include "state_buffer.hpp"
 #include "utils.hpp"
 
+#include <array>
 #include <cstdint>
 #include <fstream>
 #include <vector>
@@ -16,6 +18,20 @@ const uint8_t kInterruptionTimer   = (1 << 2);
 const uint8_t kInterruptionSerial  = (1 << 3);
 const uint8_t kInterruptionJoypad  = (1 << 4);
 
+// LCD Register Addresses
+const uint16_t kAddrLCDC = 0xff40;
+const uint16_t kAddrSTAT = 0xff41;
+const uint16_t kAddrSCY  = 0xff42;
+const uint16_t kAddrSCX  = 0xff43;
+const uint16_t kAddrLY   = 0xff44;
+const uint16_t kAddrLYC  = 0xff45;
+const uint16_t kAddrDMA  = 0xff46;
+const uint16_t kAddrBGP  = 0xff47;
+const uint16_t kAddrOBP0 = 0xff48;
+const uint16_t kAddrOBP1 = 0xff49;
+const uint16_t kAddrWY   = 0xff4a;
+const uint16_t kAddrWX   = 0xff4b;
+
 const uint8_t kLcdInterruptHBlank = (1 << 3);
 const uint8_t kLcdInterruptVBlank = (1 << 4);
 const uint8_t kLcdInterruptOAM    = (1 << 5);
@@ -36,12 +52,44 @@ enum LcdcInterrupt : uint8_t {
     LCDC_INTERRUPT_COINCI = kLcdInterruptLineEq
 };
 
+// Notified by GBMMU right before the video state (VRAM, OAM or one of the
+// LCD registers) changes, while the previous contents are still readable,
+// and before LY or STAT are read.
+class GBVideoObserver {
+public:
+    virtual ~GBVideoObserver() {}
+
+    virtual void video_memory_write(uint16_t addr, uint8_t value) = 0;
+    virtual void lcd_register_write(uint16_t addr, uint8_t value) = 0;
+    virtual void lcd_register_read(uint16_t addr) = 0;
+};
+
+const size_t kMemoryPageCount = 256; // 256 byte pages of the address space
+
+// Sees the CPU bus accesses that go through read_byte and write_byte
+class GBMemoryObserver {
+public:
+    virtual ~GBMemoryObserver() {}
+
+    virtual void memory_read(uint16_t addr, uint8_t value) = 0;
+    virtual void memory_write(uint16_t addr, uint8_t value) = 0;
+};
+
 class GBMMU {
 private:
     tick_t tick_counter;
 
     std::unique_ptr<GBCartridge> cartridge;
 
+    GBVideoObserver* video_observer;
+    GBMemoryObserver* memory_observer;
+    // pages whose accesses reach memory_observer, the others skip it
+    std::array<bool, kMemoryPageCount> observed_pages;
+
+    // cached so per-instruction tracing doesn't ask the MBC
+    uint32_t rom_bank;
+
+    uint8_t load_byte(uint16_t addr) const;
     uint8_t read_hwio(uint16_t addr) const;
 
     void write_hwio(uint16_t addr, uint8_t value);
@@ -78,9 +126,26 @@ public:
 
     void set_joypad_state(uint8_t state);
 
+    uint32_t get_rom_bank() const { return rom_bank; }
+    uint8_t read_rom_bank(uint32_t bank, uint16_t addr) const;
+
+    // read_byte without telling the memory observer, for debugging tools
+    uint8_t peek_byte(uint16_t addr) const { return load_byte(addr); }
+
+    void set_video_observer(GBVideoObserver* observer);
+    // The observer sees every page until observe_page() narrows it down
+    void set_memory_observer(GBMemoryObserver* observer);
+    void observe_page(uint8_t page, bool observed);
+    GBMemoryObserver* get_memory_observer() const { return memory_observer; }
+    bool is_page_observed(uint8_t page) const { return observed_pages[page]; }
+
     uint8_t* get_oam_ram_head();
     uint16_t get_oam_ram_size();
 
+    // Memories, I/O registers and the cartridge, observers aren't told
+    void save_state(GBStateWriter& writer) const;
+    void load_state(GBStateReader& reader);
+
     uint8_t hwio_p1;
     uint8_t hwio_sb;
     uint8_t hwio_sc;
@@ -0,0 +1,69 @@
+#ifndef OPCODE_PROFILE_HPP
+#define OPCODE_PROFILE_HPP
+
+// Instrumentation of the CPU core, built only with -DGB_OPCODE_PROFILE
+// (make DEFINES=-DGB_OPCODE_PROFILE), other builds contain none of it.
+#ifdef GB_OPCODE_PROFILE
+
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+#include "clock.hpp"
+
+// Host time stamp, the tsc where there is one and nanoseconds elsewhere
+inline uint64_t read_host_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Executions, host cycles and guest ticks per base and CB opcode of
+// every GBCPU in the process. The report goes to stderr at exit.
+class OpcodeProfile {
+private:
+    struct Counter {
+        uint64_t count;
+        uint64_t host_cycles;
+        uint64_t ticks;
+    };
+
+    Counter base[256];
+    Counter cb[256];
+
+    OpcodeProfile();
+
+public:
+    OpcodeProfile(const OpcodeProfile&) = delete;
+    ~OpcodeProfile();
+
+    static OpcodeProfile& global();
+
+    void add(bool prefixed, uint8_t opcode, uint64_t host_cycles, tick_t ticks) {
+        Counter& counter = prefixed ? cb[opcode] : base[opcode];
+        counter.count++;
+        counter.host_cycles += host_cycles;
+        counter.ticks += ticks;
+    }
+
+    uint64_t get_count(bool prefixed, uint8_t opcode) const {
+        return prefixed ? cb[opcode].count : base[opcode].count;
+    }
+
+    void clear();
+
+    // Opcodes sorted by host time, the 0xcb row includes the CB handlers
+    void write_report(std::ostream& out) const;
+};
+
+#endif
+
+#endif
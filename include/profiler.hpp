@@ -0,0 +1,115 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu.hpp"
+#include "mmu.hpp"
+#include "symbols.hpp"
+
+// Guest code profiler.
+//
+// Cycles are added per (bank, pc) to a flat histogram and per call stack
+// to a tree of frames. Calls and returns are told apart from the other
+// instructions by what they do to pc and sp: a jump that pushed a word is
+// a call or rst, a jump that popped one a ret or reti, so the CPU needs no
+// hooks and runs untouched while not profiling. Interrupt entry is given
+// by the caller, who knows when service_interrupts() took one.
+class GBProfiler {
+private:
+    struct Node {
+        uint32_t parent;
+        uint32_t function; // bank << 16 | entry address
+        uint64_t cycles;
+    };
+
+    struct Frame {
+        uint32_t node;
+        uint16_t sp; // sp on entry, a ret with this sp or above leaves it
+    };
+
+    GBCPU& cpu;
+    GBMMU& mmu;
+
+    // pc for 0x0000-0x3fff and 0x8000-0xffff and bank 1, then 0x4000
+    // entries for each bank from 2 up
+    std::vector<uint64_t> histogram;
+    uint64_t total_cycles;
+
+    std::vector<Node> nodes;
+    std::unordered_map<uint64_t, uint32_t> children;
+    std::vector<Frame> stack;
+    uint32_t current;
+    uint64_t lost_frames; // calls deeper than kMaxProfileDepth
+
+    size_t histogram_index(uint32_t bank, uint16_t pc) {
+        if (bank < 2 || pc < 0x4000 || pc >= 0x8000) {
+            return pc;
+        }
+        size_t index = 0x10000 + (bank - 2) * 0x4000 + (pc - 0x4000);
+        if (index >= histogram.size()) {
+            histogram.resize(0x10000 + (bank - 1) * 0x4000, 0);
+        }
+        return index;
+    }
+
+    static uint32_t function_key(uint32_t bank, uint16_t addr) {
+        return (addr >= 0x4000 && addr < 0x8000) ? (bank << 16) | addr : addr;
+    }
+
+    void enter(uint16_t addr, uint16_t sp);
+    void leave(uint16_t sp);
+
+    std::string function_name(uint32_t function, const GBSymbols& symbols) const;
+
+public:
+    GBProfiler(GBCPU& cpu);
+    GBProfiler(const GBProfiler&) = delete;
+
+    // Runs one instruction through cpu.step() and accounts for it
+    tick_t step() {
+        uint16_t pc = cpu.reg.pc;
+        uint16_t sp = cpu.reg.sp;
+        uint32_t bank = mmu.get_rom_bank();
+
+        tick_t t = cpu.step();
+        histogram[histogram_index(bank, pc)] += t;
+        nodes[current].cycles += t;
+        total_cycles += t;
+
+        // a call can only land past the next 3 bytes or behind pc
+        uint16_t next = cpu.reg.pc;
+        if (static_cast<uint16_t>(next - pc) > 3) {
+            if (cpu.reg.sp == static_cast<uint16_t>(sp - 2)) {
+                enter(next, cpu.reg.sp);
+            } else if (cpu.reg.sp == static_cast<uint16_t>(sp + 2)) {
+                leave(sp);
+            }
+        }
+        return t;
+    }
+
+    // After service_interrupts() jumped to a vector, t being its cost
+    void interrupt(tick_t t) {
+        enter(cpu.reg.pc, cpu.reg.sp);
+        nodes[current].cycles += t;
+        total_cycles += t;
+    }
+
+    uint64_t get_total_cycles() const { return total_cycles; }
+    uint64_t get_cycles(uint32_t bank, uint16_t pc) const;
+    uint64_t get_lost_frames() const { return lost_frames; }
+    size_t get_depth() const { return stack.size(); }
+
+    // One "root;caller;callee cycles" line per call stack, the format of
+    // flamegraph.pl and speedscope
+    void write_folded(std::ostream& out, const GBSymbols& symbols) const;
+
+    // Hottest addresses and functions, self and inclusive
+    void write_report(std::ostream& out, const GBSymbols& symbols, size_t top) const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef RECORDER_FRAME_SINK_HPP
+#define RECORDER_FRAME_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_sink.hpp"
+#include "spsc_queue.hpp"
+
+enum RecordFormat : uint8_t {
+    RECORD_RAW = 0, // one shade index byte per pixel, frames back to back
+    RECORD_Y4M = 1, // YUV4MPEG2, 4:4:4 so no color is lost to subsampling
+    RECORD_PNG = 2  // one 2 bit indexed png per frame, <stem>_<frame>.png
+};
+
+// Picks the format from the file extension (.raw, .y4m or .png)
+bool parse_record_format(const std::string& filename, RecordFormat& format);
+
+// Encodes png files with a palette of kShadePalette and 2 bit indices.
+// The zlib stream uses stored blocks, so no compression library is needed.
+std::vector<uint8_t> encode_png(const uint8_t* shades);
+
+// Records every frame while the emulation keeps running at full speed.
+//
+// present() copies the frame into a lock-free queue and returns, encoding
+// happens on a background thread. The producer only waits when the queue
+// is full, counted by get_stalls().
+//
+// A frame equal to the previous one is not written again. Instead each
+// written frame gets its start time (ms) in <filename>.timecodes, using the
+// "timecode format v2" that video muxers read for variable frame rates.
+// Times come from the frame timestamps, counted from the first frame, so
+// skipped frames and LCD-off periods keep their length in the video. The
+// png file names also carry the frame number.
+class RecorderFrameSink : public FrameSink {
+private:
+    struct Frame {
+        uint64_t number;
+        uint64_t timestamp;
+        std::vector<uint8_t> shades;
+    };
+
+    RecordFormat format;
+    std::string filename;
+    std::ofstream output;
+    std::ofstream timecodes;
+    bool opened;
+
+    SpscQueue<Frame> queue;
+    uint64_t frames_received;
+    uint64_t stalls;
+
+    std::thread encode_thread;
+    std::atomic<bool> encoding;
+    std::mutex encode_mutex;
+    std::condition_variable encode_signal;
+
+    // owned by the encode thread
+    std::vector<uint8_t> previous;
+    bool has_previous;
+    uint64_t first_timestamp;
+    std::atomic<uint64_t> frames_written;
+    std::vector<uint8_t> encoded;
+
+    void encode_loop();
+    void encode(const Frame& frame);
+
+public:
+    RecorderFrameSink(const std::string& filename, RecordFormat format);
+    RecorderFrameSink(const RecorderFrameSink&) = delete;
+    ~RecorderFrameSink();
+
+    bool is_open() const { return opened; }
+
+    // Waits for the queued frames to be written and closes the files
+    void close();
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override;
+
+    uint64_t get_frames_received() const { return frames_received; }
+    uint64_t get_frames_written() const { return frames_written; }
+    uint64_t get_stalls() const { return stalls; }
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed size history that keeps the last N entries pushed.
+//
+// N must be a power of two so wrapping around is a mask, push() is a
+// store and an increment with no branch and no allocation.
+template <typename T, size_t N>
+class RingBuffer {
+private:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+    T entries[N];
+    uint64_t count;
+
+public:
+    RingBuffer() : entries(), count(0) {}
+
+    void push(const T& entry) {
+        entries[count++ & (N - 1)] = entry;
+    }
+
+    void clear() { count = 0; }
+
+    size_t size() const { return count < N ? static_cast<size_t>(count) : N; }
+    static size_t capacity() { return N; }
+
+    // Entries pushed since the last clear, even those already overwritten
+    uint64_t total() const { return count; }
+
+    // 0 is the oldest entry kept, size() - 1 the newest
+    const T& operator[](size_t i) const {
+        return entries[(count - size() + i) & (N - 1)];
+    }
+};
+
+#endif
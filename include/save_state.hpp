@@ -0,0 +1,35 @@
+#ifndef SAVE_STATE_HPP
+#define SAVE_STATE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "gpu.hpp"
+#include "mmu.hpp"
+#include "state_buffer.hpp"
+
+const uint32_t kSaveStateVersion = 2; // 2: the GPU keeps the emulated time
+const char kSaveStateMagic[8] = {'G', 'B', 'S', 'T', 'A', 'T', 'E', '\0'};
+
+// Starts every save state, followed by the CPU, MMU (with the cartridge)
+// and GPU sections. States from other versions are refused.
+struct SaveStateHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t size; // of the whole state, header included
+};
+
+// Snapshots of the whole machine. The frame sink, observers and other
+// host side settings aren't part of it.
+//
+// Loading checks the state completely against the running machine; when
+// it is refused the machine is left as it was and error says why.
+void save_state(const GBCPU& cpu, const GBGPU& gpu, std::vector<uint8_t>& buffer);
+bool load_state(GBCPU& cpu, GBGPU& gpu, const uint8_t* data, size_t size, std::string& error);
+
+bool save_state_file(const std::string& filename, const GBCPU& cpu, const GBGPU& gpu);
+bool load_state_file(const std::string& filename, GBCPU& cpu, GBGPU& gpu, std::string& error);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SCALER_HPP
+#define SCALER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_sink.hpp"
+
+enum ScaleFilter : uint8_t {
+    SCALE_NEAREST = 0, // integer pixel replication, any factor
+    SCALE_2X      = 1, // Scale2x (AdvMAME2x), factor 2
+    SCALE_3X      = 2  // Scale3x (AdvMAME3x), factor 3
+};
+
+// Parses "1x".."8x", "scale2x" or "scale3x"
+bool parse_scale_filter(const std::string& name, ScaleFilter& filter, int& factor);
+
+// Upscales ARGB8888 frames of kScreenWidth x kScreenHeight pixels.
+//
+// Any range of source rows can be scaled on its own, so a sink can redo
+// only the rows that changed. Filters that look at the neighbour pixels
+// also change the output next to a changed row, get_border() tells how
+// many rows to add around it.
+//
+// With more than one thread the rows are split in bands, the calling
+// thread scales the first one while workers scale the others.
+class Scaler {
+private:
+    ScaleFilter filter;
+    int factor;
+
+    std::vector<std::thread> workers;
+    std::mutex job_mutex;
+    std::condition_variable job_signal;
+    std::condition_variable done_signal;
+    uint64_t job_generation;
+    int pending_bands;
+    bool running;
+
+    const uint32_t* job_src;
+    uint32_t* job_dst;
+    int job_pitch;
+    int job_first_row;
+    int job_last_row;
+
+    void worker_loop(int band);
+    void scale_band(int band);
+    void scale_rows(const uint32_t* src, uint32_t* dst, int dst_pitch,
+            int first_row, int last_row);
+
+public:
+    Scaler(ScaleFilter filter = SCALE_NEAREST, int factor = 1, int threads = 1);
+    Scaler(const Scaler&) = delete;
+    ~Scaler();
+
+    ScaleFilter get_filter() const { return filter; }
+    int get_factor() const { return factor; }
+    int get_border() const { return filter == SCALE_NEAREST ? 0 : 1; }
+    int get_output_width() const { return kScreenWidth * factor; }
+    int get_output_height() const { return kScreenHeight * factor; }
+
+    // Scales src rows [first_row, last_row] into dst, which points to the
+    // output row first_row * factor and advances dst_pitch bytes per row.
+    void scale(const uint32_t* src, uint32_t* dst, int dst_pitch,
+            int first_row = 0, int last_row = kScreenHeight - 1);
+};
+
+#endif
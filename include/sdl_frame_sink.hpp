@@ -0,0 +1,92 @@
+#ifndef SDL_FRAME_SINK_HPP
+#define SDL_FRAME_SINK_HPP
+
+#include <SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_pacer.hpp"
+#include "frame_sink.hpp"
+#include "scaler.hpp"
+#include "triple_buffer.hpp"
+
+// Shows frames in an SDL window
+class SdlFrameSink : public FrameSink {
+private:
+    SDL_Window*   window;
+    SDL_Renderer* renderer;
+    SDL_Texture*  texture;
+
+    std::string window_title;
+
+    // Completed frames are handed to the present thread, which owns the
+    // renderer and texture, so SDL_RenderPresent never stalls emulation.
+    TripleBuffer<std::vector<uint8_t>> frames;
+
+    // Last frame handed to the present thread, so repeated frames are
+    // dropped before they wake it up.
+    std::vector<uint8_t> published;
+
+    // Texture contents as shade indices, owned by the present thread. Only
+    // the rows that differ from it are expanded and uploaded.
+    std::vector<uint8_t> uploaded;
+
+    // Optional output stage, the texture is then the scaled size and the
+    // changed rows are expanded to argb before they are scaled into it.
+    std::unique_ptr<Scaler> scaler;
+    std::vector<uint32_t> argb;
+
+    // Set in vsync mode, the present thread then presents every refresh
+    // and reports it so emulation runs at the display's rate.
+    FramePacer* vsync_pacer;
+
+    std::thread present_thread;
+    std::atomic<bool> presenting;
+    std::mutex present_mutex;
+    std::condition_variable present_signal;
+
+    // While paused the present thread sleeps until a new frame, a redraw
+    // or resume(), it neither presents every refresh nor reports vsync.
+    std::atomic<bool> paused;
+    bool redraw_requested; // guarded by present_mutex
+
+    void fill(uint8_t shade);
+    void wake();
+    void present_loop();
+    void render();
+    void upload_rows(const std::vector<uint8_t>& frame, int first_row, int last_row);
+
+public:
+    SdlFrameSink();
+    SdlFrameSink(const SdlFrameSink&) = delete;
+    ~SdlFrameSink();
+
+    void show();
+    void hide();
+
+    void black();
+    void blank();
+
+    void set_window_title(const std::string&);
+
+    // Must be called before show()
+    void set_scaler(ScaleFilter filter, int factor, int threads = 1);
+
+    // Must be called before show()
+    void set_vsync(FramePacer* pacer);
+
+    void pause();
+    void resume();
+
+    // Presents the last frame again, e.g. after the window was uncovered
+    void redraw();
+
+    virtual void present(const uint8_t* shades, uint64_t timestamp) override;
+};
+
+#endif
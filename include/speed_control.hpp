@@ -0,0 +1,47 @@
+#ifndef SPEED_CONTROL_HPP
+#define SPEED_CONTROL_HPP
+
+#include <cstdint>
+#include <string>
+
+// Emulation speed as a multiple of real hardware, kUnlimitedSpeed runs as
+// fast as the host can
+const double kUnlimitedSpeed = 0;
+
+// "2", "2x", "0.5x" or "unlimited"
+bool parse_speed(const std::string& text, double& speed);
+std::string format_speed(double speed);
+
+// Speed selected in the frontend.
+//
+// The selected speed steps through 1/4x to 8x and unlimited. Turbo
+// switches to its own speed, either while held or toggled on, and falls
+// back to the selected one when released.
+class SpeedControl {
+private:
+    double selected;
+    double turbo;
+    bool turbo_held;
+    bool turbo_toggled;
+
+public:
+    SpeedControl(double speed = 1, double turbo_speed = kUnlimitedSpeed);
+
+    void set_speed(double speed) { selected = speed; }
+    double get_selected_speed() const { return selected; }
+    void faster();
+    void slower();
+
+    void set_turbo_speed(double speed) { turbo = speed; }
+    void hold_turbo(bool held) { turbo_held = held; }
+    void toggle_turbo() { turbo_toggled = !turbo_toggled; }
+    bool is_turbo() const { return turbo_held || turbo_toggled; }
+
+    double get_speed() const { return is_turbo() ? turbo : selected; }
+
+    // Render one of every n frames so the display gets frames at about
+    // its own rate, unlimited speed goes by the measured one
+    uint32_t get_frame_skip(double measured_speed) const;
+};
+
+#endif
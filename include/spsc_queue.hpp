@@ -0,0 +1,68 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free single producer / single consumer bounded queue.
+//
+// Slots are allocated once and reused, the producer fills write_slot() and
+// pushes it, the consumer reads read_slot() and pops it. Unlike
+// TripleBuffer nothing is dropped, write_slot() returns nullptr while the
+// queue is full and it's up to the producer to wait or give up.
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    std::atomic<size_t> head; // next slot to read, advanced by the consumer
+    std::atomic<size_t> tail; // next slot to write, advanced by the producer
+
+    static size_t round_capacity(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+public:
+    SpscQueue(size_t capacity, const T& init = T())
+        : slots(round_capacity(capacity), init), mask(slots.size() - 1), head(0), tail(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+
+    size_t capacity() const { return slots.size(); }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    T* write_slot() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size()) {
+            return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    void push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    T* read_slot() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+#endif
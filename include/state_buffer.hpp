@@ -0,0 +1,118 @@
+#ifndef STATE_BUFFER_HPP
+#define STATE_BUFFER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary save state streams. Values are copied as they are laid out in
+// memory, integers in the host's (little-endian) byte order, so saving is
+// a series of memcpy into one growing buffer.
+class GBStateWriter {
+private:
+    std::vector<uint8_t>& buffer;
+
+public:
+    GBStateWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {}
+
+    void write_bytes(const void* data, size_t size) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        std::memcpy(buffer.data() + offset, data, size);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+        write_bytes(&value, sizeof(T));
+    }
+
+    // Section tags let the reader tell a truncated or shifted state apart
+    // from one that merely has different values
+    void write_tag(const char (&tag)[5]) { write_bytes(tag, 4); }
+
+    template <typename T>
+    void write_vector(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+        write(static_cast<uint32_t>(values.size()));
+        write_bytes(values.data(), values.size() * sizeof(T));
+    }
+};
+
+// Reads what GBStateWriter wrote. The first problem makes every later
+// read fail, so callers check is_ok() once at the end.
+class GBStateReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    std::string error;
+
+public:
+    GBStateReader(const uint8_t* data, size_t size) : data(data), size(size), offset(0) {}
+
+    bool is_ok() const { return error.empty(); }
+    const std::string& get_error() const { return error; }
+    size_t get_remaining() const { return size - offset; }
+
+    void fail(const std::string& message) {
+        if (error.empty()) {
+            error = message;
+        }
+    }
+
+    bool read_bytes(void* value, size_t length) {
+        if (!error.empty()) {
+            return false;
+        }
+        if (length > size - offset) {
+            fail("save state is truncated");
+            return false;
+        }
+        std::memcpy(value, data + offset, length);
+        offset += length;
+        return true;
+    }
+
+    template <typename T>
+    bool read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read");
+        return read_bytes(&value, sizeof(T));
+    }
+
+    bool read_tag(const char (&tag)[5]) {
+        char found[4];
+        if (read_bytes(found, 4) && std::memcmp(found, tag, 4) != 0) {
+            fail(std::string("save state section ") + tag + " not found");
+        }
+        return is_ok();
+    }
+
+    // Fixed size memories, the stored size must match
+    template <typename T>
+    bool read_vector(std::vector<T>& values) {
+        uint32_t count = 0;
+        if (read(count) && count != values.size()) {
+            fail("save state memory size differs");
+        }
+        return read_bytes(values.data(), values.size() * sizeof(T));
+    }
+
+    // Variable length lists, up to max_count entries
+    template <typename T>
+    bool read_list(std::vector<T>& values, uint32_t max_count) {
+        uint32_t count = 0;
+        if (read(count) && count > max_count) {
+            fail("save state list is too long");
+        }
+        if (!is_ok()) {
+            return false;
+        }
+        values.resize(count);
+        return read_bytes(values.data(), count * sizeof(T));
+    }
+};
+
+#endif
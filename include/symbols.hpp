@@ -0,0 +1,34 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Symbol names from an RGBDS .sym file, lines of "BB:AAAA Name"
+//
+// Addresses in 0x4000-0x7fff belong to a ROM bank, everything else is
+// looked up in bank 0 like rgblink writes it.
+class GBSymbols {
+private:
+    std::map<uint32_t, std::string> symbols;
+
+    static uint32_t key(uint32_t bank, uint16_t addr) {
+        return (addr >= 0x4000 && addr < 0x8000) ? (bank << 16) | addr : addr;
+    }
+
+public:
+    bool load(const std::string& filename);
+    void add(uint32_t bank, uint16_t addr, const std::string& name);
+
+    size_t size() const { return symbols.size(); }
+
+    // Exact name, or "" when there is no symbol at the address
+    std::string exact(uint32_t bank, uint16_t addr) const;
+
+    // "Name", "Name+0x12" from the closest symbol before it in the same
+    // bank, or "BB:AAAA" when there is none
+    std::string describe(uint32_t bank, uint16_t addr) const;
+};
+
+#endif
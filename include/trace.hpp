@@ -0,0 +1,130 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu.hpp"
+#include "mmu.hpp"
+#include "spsc_queue.hpp"
+
+// Binary execution trace, a header followed by fixed size entries:
+//
+//   TraceHeader  "GBTRACE\0", version, entry size, mode
+//   TraceEntry*  little endian, kTraceEntrySize bytes each
+//
+// Instruction entries hold the state before the instruction at pc runs,
+// memory entries the address in pc and the value in opcode.
+enum TraceMode : uint8_t {
+    TRACE_FULL    = 0, // every instruction
+    TRACE_BRANCH  = 1, // only instructions not reached by falling through
+    TRACE_MEMORY  = 2  // every instruction and every bus access
+};
+
+enum TraceKind : uint8_t {
+    TRACE_INSTRUCTION  = 0,
+    TRACE_MEMORY_READ  = 1,
+    TRACE_MEMORY_WRITE = 2
+};
+
+const uint32_t kTraceVersion = 1;
+const char kTraceMagic[8] = {'G', 'B', 'T', 'R', 'A', 'C', 'E', '\0'};
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t mode;
+    uint32_t reserved;
+};
+
+struct TraceEntry {
+    uint64_t cycle;
+    uint16_t pc;
+    uint16_t af;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint16_t sp;
+    uint8_t  opcode;
+    uint8_t  kind;
+    uint16_t bank;
+};
+
+const size_t kTraceEntrySize = sizeof(TraceEntry);
+static_assert(kTraceEntrySize == 24, "TraceEntry must stay packed, it is the file format");
+
+bool parse_trace_mode(const std::string& name, TraceMode& mode);
+
+// One line description of an entry, for tools
+std::string format_trace_entry(const TraceEntry& entry);
+
+// Records a trace while emulating.
+//
+// Entries are appended to a block in place, full blocks go through a
+// lock-free queue to a writer thread. The emulation only waits when the
+// writer falls behind by the whole queue, a trace is never lossy.
+class GBTraceRecorder : public GBMemoryObserver {
+private:
+    struct Block {
+        std::vector<TraceEntry> entries;
+        size_t size;
+    };
+
+    TraceMode mode;
+    FILE* file;
+
+    SpscQueue<Block> queue;
+    Block* block;
+    uint64_t entry_count;
+    uint64_t stalls;
+
+    uint16_t next_pc; // where execution falls through to, for TRACE_BRANCH
+    bool has_next_pc;
+    bool fetching;    // our own opcode read is not a bus access to trace
+    uint64_t cycle;
+
+    std::thread write_thread;
+    std::atomic<bool> writing;
+    std::mutex write_mutex;
+    std::condition_variable write_signal;
+
+    void write_loop();
+    void flush_block();
+
+    void append(const TraceEntry& entry) {
+        block->entries[block->size++] = entry;
+        entry_count++;
+        if (block->size == block->entries.size()) {
+            flush_block();
+        }
+    }
+
+public:
+    GBTraceRecorder(const std::string& filename, TraceMode mode);
+    GBTraceRecorder(const GBTraceRecorder&) = delete;
+    ~GBTraceRecorder();
+
+    bool is_open() const { return file != nullptr; }
+    TraceMode get_mode() const { return mode; }
+
+    // Writes what is buffered and closes the file
+    void close();
+
+    // Called before each instruction, cycle counts ticks since the start
+    void record_instruction(const GBCPU& cpu, uint64_t cycle);
+
+    virtual void memory_read(uint16_t addr, uint8_t value) override;
+    virtual void memory_write(uint16_t addr, uint8_t value) override;
+
+    uint64_t get_entry_count() const { return entry_count; }
+    uint64_t get_stalls() const { return stalls; }
+};
+
+#endif
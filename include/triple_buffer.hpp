@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer triple buffer.
+//
+// The producer fills back_buffer() and publishes it, the consumer calls
+// update() to swap in the latest published buffer. Neither side ever waits
+// for the other, and intermediate frames are dropped when the consumer is
+// slower than the producer.
+template <typename T>
+class TripleBuffer {
+private:
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kFreshFlag = 0x4;
+
+    T buffers[3];
+
+    std::atomic<uint8_t> middle; // shared index, fresh flag when unread
+    uint8_t back;                // owned by the producer
+    uint8_t front;               // owned by the consumer
+
+public:
+    TripleBuffer(const T& init = T())
+        : buffers{init, init, init}, middle(1), back(0), front(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+
+    T& back_buffer() { return buffers[back]; }
+
+    void publish() {
+        back = middle.exchange(back | kFreshFlag, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    bool has_update() const {
+        return middle.load(std::memory_order_acquire) & kFreshFlag;
+    }
+
+    bool update() {
+        if (!has_update()) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    const T& front_buffer() const { return buffers[front]; }
+};
+
+#endif
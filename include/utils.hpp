@@ -11,4 +11,7 @@ std::stringstream print_bytes(std::vector<uint8_t>::iterator b, std::vector<uint
 
 std::vector<std::string> text_to_line_vector(std::stringstream& ss);
 
+// Fast non-cryptographic 64 bit hash, eight bytes per round
+uint64_t hash64(const uint8_t* data, size_t size, uint64_t seed = 0);
+
 #endif
@@ -0,0 +1,326 @@
+/*
+ * breakpoints.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "breakpoints.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+bool parse_number(const std::string& text, int base, uint16_t& number) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    unsigned long value = std::strtoul(text.c_str(), &end, base);
+    if (*end != '\0' || value > 0xffff) {
+        return false;
+    }
+    number = static_cast<uint16_t>(value);
+    return true;
+}
+
+// decimal, or hex with a 0x prefix
+bool parse_value(const std::string& text, uint16_t& number) {
+    if (text.compare(0, 2, "0x") == 0) {
+        return parse_number(text.substr(2), 16, number);
+    }
+    return parse_number(text, 10, number);
+}
+
+std::vector<std::string> split(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream stream(text);
+    std::string word;
+    while (stream >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+}
+
+bool BreakCondition::compile(const std::string& text, BreakCondition& condition, std::string& error) {
+    static const char* operand_names[] = {
+        "a", "f", "b", "c", "d", "e", "h", "l", "af", "bc", "de", "hl", "sp", "pc", "value"
+    };
+    static const char* compare_names[] = {"==", "!=", "<", "<=", ">", ">="};
+
+    condition.terms.clear();
+
+    std::vector<std::string> words = split(text);
+    for (size_t i = 0; i < words.size(); i += 4) {
+        if (i + 3 > words.size()) {
+            error = "incomplete comparison in \"" + text + "\"";
+            return false;
+        }
+
+        Term term = Term();
+        const std::string& operand = words[i];
+        if (operand.size() > 2 && operand.front() == '[' && operand.back() == ']') {
+            term.operand = OPERAND_MEMORY;
+            if (!parse_number(operand.substr(1, operand.size() - 2), 16, term.address)) {
+                error = "bad address " + operand;
+                return false;
+            }
+        } else {
+            auto name = std::find(std::begin(operand_names), std::end(operand_names), operand);
+            if (name == std::end(operand_names)) {
+                error = "unknown operand " + operand;
+                return false;
+            }
+            term.operand = static_cast<Operand>(name - std::begin(operand_names));
+        }
+
+        auto compare = std::find(std::begin(compare_names), std::end(compare_names), words[i + 1]);
+        if (compare == std::end(compare_names)) {
+            error = "unknown comparison " + words[i + 1];
+            return false;
+        }
+        term.compare = static_cast<Compare>(compare - std::begin(compare_names));
+
+        if (!parse_value(words[i + 2], term.value)) {
+            error = "bad number " + words[i + 2];
+            return false;
+        }
+
+        if (i + 3 < words.size() && words[i + 3] != "&&") {
+            error = "expected && before " + words[i + 3];
+            return false;
+        }
+        if (i + 3 == words.size() - 1) {
+            error = "condition ends with &&";
+            return false;
+        }
+
+        condition.terms.push_back(term);
+    }
+    return true;
+}
+
+bool BreakCondition::evaluate(const GBCPU& cpu, uint8_t value) const {
+    for (const Term& term : terms) {
+        uint16_t operand = 0;
+        switch (term.operand) {
+            case OPERAND_A:      operand = cpu.reg.a; break;
+            case OPERAND_F:      operand = cpu.reg.f; break;
+            case OPERAND_B:      operand = cpu.reg.b; break;
+            case OPERAND_C:      operand = cpu.reg.c; break;
+            case OPERAND_D:      operand = cpu.reg.d; break;
+            case OPERAND_E:      operand = cpu.reg.e; break;
+            case OPERAND_H:      operand = cpu.reg.h; break;
+            case OPERAND_L:      operand = cpu.reg.l; break;
+            case OPERAND_AF:     operand = cpu.reg.af; break;
+            case OPERAND_BC:     operand = cpu.reg.bc; break;
+            case OPERAND_DE:     operand = cpu.reg.de; break;
+            case OPERAND_HL:     operand = cpu.reg.hl; break;
+            case OPERAND_SP:     operand = cpu.reg.sp; break;
+            case OPERAND_PC:     operand = cpu.reg.pc; break;
+            case OPERAND_VALUE:  operand = value; break;
+            case OPERAND_MEMORY: operand = cpu.mmu.peek_byte(term.address); break;
+        }
+
+        bool holds = false;
+        switch (term.compare) {
+            case COMPARE_EQ: holds = operand == term.value; break;
+            case COMPARE_NE: holds = operand != term.value; break;
+            case COMPARE_LT: holds = operand <  term.value; break;
+            case COMPARE_LE: holds = operand <= term.value; break;
+            case COMPARE_GT: holds = operand >  term.value; break;
+            case COMPARE_GE: holds = operand >= term.value; break;
+        }
+        if (!holds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+GBBreakpoints::GBBreakpoints(GBCPU& cpu) :
+    cpu(cpu), mmu(cpu.mmu), next_id(1),
+    armed(false), observing(false), chained(nullptr),
+    hit_pending(false), resuming(false), hit() {
+
+    page_kinds.fill(0);
+    chained_pages.fill(false);
+}
+
+GBBreakpoints::~GBBreakpoints() {
+    clear();
+}
+
+uint32_t GBBreakpoints::add(const std::string& spec, std::string& error) {
+    std::string where = spec;
+    std::string condition_text;
+    size_t if_pos = spec.find(" if ");
+    if (if_pos != std::string::npos) {
+        where = spec.substr(0, if_pos);
+        condition_text = spec.substr(if_pos + 4);
+    }
+
+    std::vector<std::string> words = split(where);
+    if (words.size() != 2) {
+        error = "expected <kinds> <addr>[-<addr>] in \"" + spec + "\"";
+        return 0;
+    }
+
+    uint8_t kinds = 0;
+    for (char c : words[0]) {
+        switch (c) {
+            case 'x': kinds |= BREAK_EXECUTE; break;
+            case 'r': kinds |= BREAK_READ;    break;
+            case 'w': kinds |= BREAK_WRITE;   break;
+            default:
+                error = "unknown kind " + std::string(1, c) + ", expected x, r or w";
+                return 0;
+        }
+    }
+
+    uint16_t first = 0;
+    uint16_t last = 0;
+    size_t dash = words[1].find('-');
+    if (!parse_number(words[1].substr(0, dash), 16, first)
+            || !parse_number(dash == std::string::npos ? words[1] : words[1].substr(dash + 1), 16, last)
+            || last < first) {
+        error = "bad address range " + words[1];
+        return 0;
+    }
+
+    BreakCondition condition;
+    if (!BreakCondition::compile(condition_text, condition, error)) {
+        return 0;
+    }
+
+    uint32_t id = add(kinds, first, last, condition);
+    breakpoints.back().text = spec;
+    return id;
+}
+
+uint32_t GBBreakpoints::add(uint8_t kinds, uint16_t first, uint16_t last, const BreakCondition& condition) {
+    Breakpoint breakpoint;
+    breakpoint.id = next_id++;
+    breakpoint.kinds = kinds;
+    breakpoint.first = first;
+    breakpoint.last = last;
+    breakpoint.condition = condition;
+    breakpoint.hits = 0;
+    breakpoints.push_back(breakpoint);
+
+    rebuild();
+    return breakpoint.id;
+}
+
+bool GBBreakpoints::remove(uint32_t id) {
+    auto it = std::find_if(breakpoints.begin(), breakpoints.end(), [id](const Breakpoint& breakpoint) {
+        return breakpoint.id == id;
+    });
+    if (it == breakpoints.end()) {
+        return false;
+    }
+    breakpoints.erase(it);
+    rebuild();
+    return true;
+}
+
+void GBBreakpoints::clear() {
+    breakpoints.clear();
+    rebuild();
+}
+
+void GBBreakpoints::rebuild() {
+    execute_addrs.reset();
+    read_addrs.reset();
+    write_addrs.reset();
+    page_kinds.fill(0);
+
+    for (const Breakpoint& breakpoint : breakpoints) {
+        for (uint32_t addr = breakpoint.first; addr <= breakpoint.last; addr++) {
+            if (breakpoint.kinds & BREAK_EXECUTE) {
+                execute_addrs.set(addr);
+            }
+            if (breakpoint.kinds & BREAK_READ) {
+                read_addrs.set(addr);
+            }
+            if (breakpoint.kinds & BREAK_WRITE) {
+                write_addrs.set(addr);
+            }
+            page_kinds[addr >> 8] |= breakpoint.kinds;
+        }
+    }
+
+    // only watched pages take the slow path through memory_read/write
+    bool watching = false;
+    for (size_t page = 0; page < kMemoryPageCount; page++) {
+        watching |= (page_kinds[page] & (BREAK_READ | BREAK_WRITE)) != 0;
+    }
+    if (watching) {
+        if (!observing) {
+            chained = mmu.get_memory_observer();
+            for (size_t page = 0; page < kMemoryPageCount; page++) {
+                chained_pages[page] = chained && mmu.is_page_observed(page);
+            }
+        }
+        mmu.set_memory_observer(this);
+        for (size_t page = 0; page < kMemoryPageCount; page++) {
+            mmu.observe_page(page, chained_pages[page] || (page_kinds[page] & (BREAK_READ | BREAK_WRITE)) != 0);
+        }
+    } else if (observing) {
+        mmu.set_memory_observer(chained);
+        for (size_t page = 0; page < kMemoryPageCount; page++) {
+            mmu.observe_page(page, chained_pages[page]);
+        }
+        chained = nullptr;
+    }
+    observing = watching;
+
+    armed = !breakpoints.empty();
+    hit_pending = false;
+}
+
+bool GBBreakpoints::match(BreakKind kind, uint16_t addr, uint8_t value) {
+    for (Breakpoint& breakpoint : breakpoints) {
+        if ((breakpoint.kinds & kind) && addr >= breakpoint.first && addr <= breakpoint.last
+                && breakpoint.condition.evaluate(cpu, value)) {
+            breakpoint.hits++;
+            hit = BreakHit{breakpoint.id, kind, addr, value};
+            return true;
+        }
+    }
+    return false;
+}
+
+void GBBreakpoints::memory_read(uint16_t addr, uint8_t value) {
+    if (chained && chained_pages[addr >> 8]) {
+        chained->memory_read(addr, value);
+    }
+    if (!hit_pending && read_addrs[addr] && match(BREAK_READ, addr, value)) {
+        hit_pending = true;
+    }
+}
+
+void GBBreakpoints::memory_write(uint16_t addr, uint8_t value) {
+    if (chained && chained_pages[addr >> 8]) {
+        chained->memory_write(addr, value);
+    }
+    if (!hit_pending && write_addrs[addr] && match(BREAK_WRITE, addr, value)) {
+        hit_pending = true;
+    }
+}
+
+std::string GBBreakpoints::describe(const BreakHit& hit) const {
+    char line[96];
+    if (hit.kind == BREAK_EXECUTE) {
+        std::snprintf(line, sizeof(line), "breakpoint %u: execute %04x", hit.id, hit.addr);
+    } else {
+        std::snprintf(line, sizeof(line), "breakpoint %u: %s %04x = %02x, stopped at %04x", hit.id,
+            hit.kind == BREAK_READ ? "read" : "write", hit.addr, hit.value, cpu.reg.pc);
+    }
+    return std::string(line);
+}
@@ -1,5 +1,6 @@
 #include "cartridge.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
@@ -9,6 +10,7 @@ const int kAddrCartridgeType = 0x147;
 const int kAddrCartridgeROMSize = 0x148;
 const int kAddrCartridgeRAMSize = 0x149;
 const int kAddrCartridgeDestinationCode = 0x14a;
+const int kAddrCartridgeHeaderChecksum = 0x14d; // then the 2 byte global checksum
 
 bool contains_mbc(uint8_t cartridge_type);
 bool contains_rom(uint8_t cartridge_type);
@@ -142,6 +144,19 @@ uint8_t GBCartridge::read(uint16_t addr) const {
     return 0;
 }
 
+uint32_t GBCartridge::get_rom_bank() const {
+    return has_mbc ? mbc->get_rom_bank() : 1;
+}
+
+uint8_t GBCartridge::read_rom_bank(uint32_t bank, uint16_t addr) const {
+    if (!has_rom || addr > 0x7fff) {
+        return 0;
+    }
+
+    uint32_t offset = (addr <= 0x3fff) ? addr : addr + (bank - 1) * 0x4000;
+    return (offset < rom.size()) ? rom[offset] : 0;
+}
+
 void GBCartridge::write(uint16_t addr, uint8_t value) {
     if (has_mbc && (addr >= 0x0000 && addr <= 0x7fff)) {
         mbc->write(addr, value);
@@ -152,6 +167,36 @@ void GBCartridge::write(uint16_t addr, uint8_t value) {
     }
 }
 
+// Size and checksums of the ROM a state belongs to
+static uint64_t rom_identity(const std::vector<uint8_t>& rom) {
+    uint64_t identity = static_cast<uint64_t>(rom.size()) << 24;
+    if (rom.size() > kAddrCartridgeHeaderChecksum + 2) {
+        identity |= rom[kAddrCartridgeHeaderChecksum] << 16;
+        identity |= rom[kAddrCartridgeHeaderChecksum + 1] << 8;
+        identity |= rom[kAddrCartridgeHeaderChecksum + 2];
+    }
+    return identity;
+}
+
+void GBCartridge::save_state(GBStateWriter& writer) const {
+    writer.write_tag("CART");
+    writer.write(rom_identity(rom));
+    mbc->save_state(writer);
+    writer.write_vector(ram);
+}
+
+void GBCartridge::load_state(GBStateReader& reader) {
+    uint64_t identity = 0;
+    if (reader.read_tag("CART") && reader.read(identity) && identity != rom_identity(rom)) {
+        reader.fail("save state belongs to a different ROM");
+    }
+    if (!reader.is_ok()) {
+        return;
+    }
+    mbc->load_state(reader);
+    reader.read_vector(ram);
+}
+
 void GBCartridge::dma_read(uint16_t addr, uint16_t length, std::vector<uint8_t>::iterator dst) {
     if (has_rom && (addr >= 0x0000 && addr <= 0x7fff)) {
         std::copy(
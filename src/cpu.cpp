@@ -626,6 +626,120 @@ void GBCPU::reset() {
     std::memset(this, 0, sizeof(GBCPU));
 }
 
+void GBCPU::save_state(GBStateWriter& writer) const {
+    writer.write_tag("CPU ");
+    writer.write(reg);
+}
+
+void GBCPU::load_state(GBStateReader& reader) {
+    reader.read_tag("CPU ");
+    reader.read(reg);
+}
+
+/**
+ * Skip the boot rom, leaving registers as it would at 0x0100
+ */
+void GBCPU::unload_bios() {
+    reg.af = 0x00b0;
+    reg.bc = 0x0013;
+    reg.de = 0x00d8;
+    reg.hl = 0x014d;
+    reg.sp = 0xfffe;
+    reg.pc = 0x0100;
+
+    mmu.bios_loaded = false;
+
+    mmu.hwio_tima = 0x00;
+    mmu.hwio_tma  = 0x00;
+    mmu.hwio_tac  = 0x00;
+
+    mmu.hwio_nr10 = 0x80;
+    mmu.hwio_nr11 = 0xbf;
+    mmu.hwio_nr12 = 0xf3;
+    mmu.hwio_nr14 = 0xbf;
+
+    mmu.hwio_nr21 = 0x3f;
+    mmu.hwio_nr22 = 0x00;
+    mmu.hwio_nr24 = 0xbf;
+
+    mmu.hwio_nr30 = 0x7f;
+    mmu.hwio_nr31 = 0xff;
+    mmu.hwio_nr32 = 0x9f;
+    mmu.hwio_nr33 = 0xbf;
+
+    mmu.hwio_nr41 = 0xff;
+    mmu.hwio_nr42 = 0x00;
+    mmu.hwio_nr43 = 0x00;
+    mmu.hwio_nr44 = 0xbf;
+
+    mmu.hwio_nr50 = 0x77;
+    mmu.hwio_nr51 = 0xf3;
+    mmu.hwio_nr52 = 0xf1;
+
+    mmu.hwio_lcdc = 0x91;
+    mmu.hwio_stat = 0x02;
+    mmu.hwio_scy  = 0x00;
+    mmu.hwio_scx  = 0x00;
+    mmu.hwio_lyc  = 0x00;
+    mmu.hwio_bgp  = 0xfc;
+    mmu.hwio_obp0 = 0xff;
+    mmu.hwio_obp1 = 0xff;
+    mmu.hwio_wx   = 0x00;
+    mmu.hwio_wy   = 0x00;
+    mmu.hwio_ie   = 0x00;
+}
+
+/**
+ * Fetch, decode and execute the instruction at PC
+ */
+tick_t GBCPU::step() {
+    // fetch
+    uint8_t op = mmu.read_byte(reg.pc++);
+
+    // decode
+    auto& instruction = instruction_map.at(op);
+
+    // execute
+#ifdef GB_OPCODE_PROFILE
+    uint64_t start = read_host_cycles();
+    tick_t t = (this->*instruction)();
+    OpcodeProfile::global().add(false, op, read_host_cycles() - start, t);
+    return t;
+#else
+    return (this->*instruction)();
+#endif
+}
+
+/**
+ * Jump to the vector of the highest priority pending interrupt, if any
+ */
+tick_t GBCPU::service_interrupts() {
+    if (!mmu.interrupt_master_enabled || !(mmu.hwio_ie & mmu.hwio_if)) {
+        return 0;
+    }
+
+    mmu.disable_interrupts();
+
+    tick_t t = 0;
+    if (mmu.hwio_if & kInterruptionVBlank) {
+        mmu.hwio_if &= ~kInterruptionVBlank;
+        t += rst_40();
+    } else if (mmu.hwio_if & kInterruptionLcdStat) {
+        mmu.hwio_if &= ~kInterruptionLcdStat;
+        t += rst_48();
+    } else if (mmu.hwio_if & kInterruptionTimer) {
+        mmu.hwio_if &= ~kInterruptionTimer;
+        t += rst_50();
+    } else if (mmu.hwio_if & kInterruptionSerial) {
+        mmu.hwio_if &= ~kInterruptionSerial;
+        t += rst_58();
+    } else if (mmu.hwio_if & kInterruptionJoypad) {
+        mmu.hwio_if &= ~kInterruptionJoypad;
+        t += rst_60();
+    }
+    return t;
+}
+
 tick_t GBCPU::ld_r_r(uint8_t& dst_reg, uint8_t src_reg) {
     dst_reg = src_reg;
     return 4;
@@ -7,14 +7,30 @@
 
 #include "debugger.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <utility>
 #include <vector>
 
+const int kDebuggerWidth  = 700;
+const int kDebuggerHeight = 900;
+
+const SDL_Color kTextColor       = {0, 0, 0, 0};
+const SDL_Color kBackgroundColor = {255, 255, 255, 0};
+
+const int kDebuggerRefreshMillis = 33;
+
 Debugger::Debugger(GBCPU& cpu, GBGPU& gpu, GBJoypad& joypad) :
-    cpu(cpu), gpu(gpu), mmu(cpu.mmu), joypad(joypad), window(nullptr), renderer(nullptr), font(nullptr) {
+    cpu(cpu), gpu(gpu), mmu(cpu.mmu), joypad(joypad), window(nullptr),
+    snapshots(DebugSnapshot()), snapshot_count(0), running(false),
+    renderer(nullptr), font(nullptr), canvas(nullptr) {
+
+}
 
+Debugger::~Debugger() {
+    hide();
 }
 
 void Debugger::show() {
@@ -22,56 +38,118 @@ void Debugger::show() {
         window = SDL_CreateWindow("GBDebugger",
             SDL_WINDOWPOS_UNDEFINED,
             SDL_WINDOWPOS_UNDEFINED,
-            700,
-            900,
+            kDebuggerWidth,
+            kDebuggerHeight,
             SDL_WINDOW_SHOWN);
 
         if (window) {
-            renderer = SDL_CreateRenderer(window, -1, 0);
-            if (!renderer) {
-                std::cerr << "SDL_CreateRenderer failed: " << SDL_GetError() << "\n";
-            }
-
-            font = TTF_OpenFont("res/font/DroidSansMono.ttf", 12);
-            if (font) {
-                TTF_SetFontHinting(font, TTF_HINTING_MONO);
-            } else {
-                std::cerr << "TTF_OpenFont failed: " << TTF_GetError() << "\n";
-            }
-
+            history.clear();
+            running = true;
+            ui_thread = std::thread(&Debugger::ui_loop, this);
         } else {
             std::cerr << "SDL_CreateWindow failed: " << SDL_GetError() << "\n";
         }
     }
-
 }
 
 void Debugger::hide() {
-    if (!font) {
-        TTF_CloseFont(font);
-        font = nullptr;
-    }
-
-    if (renderer) {
-        SDL_DestroyRenderer(renderer);
-        renderer = nullptr;
+    if (ui_thread.joinable()) {
+        running = false;
+        ui_signal.notify_one();
+        ui_thread.join();
     }
 
     if (window) {
         SDL_DestroyWindow(window);
         window = nullptr;
     }
+}
+
+void Debugger::publish_snapshot() {
+    if (!running) {
+        return;
+    }
 
+    DebugSnapshot& snapshot = snapshots.back_buffer();
+    snapshot.reg = cpu.reg;
+    std::copy(mmu.iram.begin(), mmu.iram.begin() + kDebuggerMemorySize, snapshot.iram);
+
+    // bytes are read now, memory may change before the ui thread runs.
+    // Peeked, so the snapshot doesn't trip watchpoints or show up in a
+    // memory trace.
+    snapshot.history_size = history.size();
+    for (size_t i = 0; i < history.size(); i++) {
+        uint16_t pc = history[i].pc;
+        snapshot.history[i].pc = pc;
+        for (int j = 0; j < 3; j++) {
+            uint16_t addr = static_cast<uint16_t>(pc + j);
+            snapshot.history[i].bytes[j] = (addr < 0x8000)
+                ? mmu.read_rom_bank(history[i].bank, addr) : mmu.peek_byte(addr);
+        }
+    }
+
+    snapshot.number = snapshot_count++;
+    snapshots.publish();
 }
 
-void Debugger::draw() {
-    if (!window || !renderer || !font) {
+void Debugger::ui_loop() {
+    renderer = SDL_CreateRenderer(window, -1, 0);
+    if (!renderer) {
+        std::cerr << "SDL_CreateRenderer failed: " << SDL_GetError() << "\n";
         return;
     }
 
-    auto reg_dump = dump_registers();
-    auto mem_dump = dump_memory();
-    auto cpu_dump = dump_executed_instructions();
+    font = TTF_OpenFont("res/font/DroidSansMono.ttf", 12);
+    if (font) {
+        TTF_SetFontHinting(font, TTF_HINTING_MONO);
+        atlas.reset(new GlyphAtlas(renderer, font, kTextColor, kBackgroundColor));
+    } else {
+        std::cerr << "TTF_OpenFont failed: " << TTF_GetError() << "\n";
+    }
+
+    canvas = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_TARGET,
+        kDebuggerWidth, kDebuggerHeight);
+    if (!canvas) {
+        std::cerr << "SDL_CreateTexture failed: " << SDL_GetError() << "\n";
+    }
+    drawn_lines.clear();
+
+    while (running) {
+        {
+            // refresh at most every kDebuggerRefreshMillis, whatever the
+            // emulation speed
+            std::unique_lock<std::mutex> lock(ui_mutex);
+            ui_signal.wait_for(lock, std::chrono::milliseconds(kDebuggerRefreshMillis), [this] {
+                return !running;
+            });
+        }
+
+        if (running && atlas && atlas->is_valid() && canvas && snapshots.update()) {
+            draw(snapshots.front_buffer());
+        }
+    }
+
+    if (canvas) {
+        SDL_DestroyTexture(canvas);
+        canvas = nullptr;
+    }
+    atlas.reset();
+
+    if (font) {
+        TTF_CloseFont(font);
+        font = nullptr;
+    }
+
+    SDL_DestroyRenderer(renderer);
+    renderer = nullptr;
+}
+
+void Debugger::draw(const DebugSnapshot& snapshot) {
+    auto reg_dump = dump_registers(snapshot.reg);
+    auto mem_dump = dump_memory(snapshot);
+    auto cpu_dump = dump_executed_instructions(snapshot);
 
     std::vector<std::string> lines;
     lines.push_back("CPU Registers:");
@@ -81,85 +159,78 @@ void Debugger::draw() {
     lines.push_back("IRAM Dump:");
     lines.insert(lines.end(), mem_dump.begin(), mem_dump.end());
 
-    std::vector<std::pair<SDL_Surface*, SDL_Texture*>> render_list;
-    for (auto &line : lines) {
-        auto surface = TTF_RenderText_Shaded(font, line.c_str(), {0, 0, 0, 0}, {255, 255, 255, 0});
-        auto texture = SDL_CreateTextureFromSurface(renderer, surface);
-        render_list.push_back(std::make_pair(surface, texture));
+    SDL_SetRenderTarget(renderer, canvas);
+    SDL_SetRenderDrawColor(renderer, kBackgroundColor.r, kBackgroundColor.g, kBackgroundColor.b, 0xff);
+
+    if (drawn_lines.empty()) {
+        SDL_RenderClear(renderer);
     }
 
-    SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
-    SDL_RenderClear(renderer);
+    bool changed = false;
+    int line_height = atlas->get_line_height();
+    for (size_t i = 0; i < std::max(lines.size(), drawn_lines.size()); i++) {
+        const std::string& line = i < lines.size() ? lines[i] : std::string();
+        if (i < drawn_lines.size() && drawn_lines[i] == line) {
+            continue;
+        }
 
-    int y = 0;
-    for (auto &render_pair : render_list) {
-        SDL_Rect rect = {0, y, 0, 0};
-        SDL_QueryTexture(render_pair.second, NULL, NULL, &rect.w, &rect.h);
-        SDL_RenderCopy(renderer, render_pair.second, NULL, &rect);
-        y += rect.h;
+        SDL_Rect rect = {0, static_cast<int>(i) * line_height, kDebuggerWidth, line_height};
+        SDL_RenderFillRect(renderer, &rect);
+        atlas->draw_text(renderer, line, 0, rect.y);
+        changed = true;
     }
+    drawn_lines = lines;
 
-    SDL_RenderPresent(renderer);
+    SDL_SetRenderTarget(renderer, nullptr);
 
-    for (auto &render_pair : render_list) {
-        SDL_DestroyTexture(render_pair.second);
-        SDL_FreeSurface(render_pair.first);
+    if (changed) {
+        SDL_RenderCopy(renderer, canvas, NULL, NULL);
+        SDL_RenderPresent(renderer);
     }
 }
 
-std::vector<std::string> Debugger::dump_registers() {
+std::vector<std::string> Debugger::dump_registers(const Registers& reg) {
     std::stringstream cpu_register_dump;
 
     cpu_register_dump << std::hex;
 
-    cpu_register_dump << "a:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.a) << " ";
-    cpu_register_dump << "f:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.f) << " ";
-
-    cpu_register_dump << "b:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.b) << " ";
-    cpu_register_dump << "c:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.c) << " ";
-    cpu_register_dump << "d:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.d) << " ";
-    cpu_register_dump << "e:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.e) << " ";
-    cpu_register_dump << "h:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.h) << " ";
-    cpu_register_dump << "l:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(cpu.reg.l) << " ";
-
-    cpu_register_dump << ((cpu.reg.f & 0x80) ? "z" : "-");
-    cpu_register_dump << ((cpu.reg.f & 0x40) ? "n" : "-");
-    cpu_register_dump << ((cpu.reg.f & 0x20) ? "h" : "-");
-    cpu_register_dump << ((cpu.reg.f & 0x10) ? "c" : "-") << "\n";
-
-    cpu_register_dump << "bc:" << std::setw(4) << std::setfill('0') << cpu.reg.bc << " ";
-    cpu_register_dump << "de:" << std::setw(4) << std::setfill('0') << cpu.reg.de << " ";
-    cpu_register_dump << "hl:" << std::setw(4) << std::setfill('0') << cpu.reg.hl << " ";
-    cpu_register_dump << "sp:" << std::setw(4) << std::setfill('0') << cpu.reg.sp << " ";
-    cpu_register_dump << "pc:" << std::setw(4) << std::setfill('0') << cpu.reg.pc << "\n";
+    cpu_register_dump << "a:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.a) << " ";
+    cpu_register_dump << "f:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.f) << " ";
+
+    cpu_register_dump << "b:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.b) << " ";
+    cpu_register_dump << "c:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.c) << " ";
+    cpu_register_dump << "d:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.d) << " ";
+    cpu_register_dump << "e:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.e) << " ";
+    cpu_register_dump << "h:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.h) << " ";
+    cpu_register_dump << "l:" << std::setw(2) << std::setfill('0') << static_cast<uint16_t>(reg.l) << " ";
+
+    cpu_register_dump << ((reg.f & 0x80) ? "z" : "-");
+    cpu_register_dump << ((reg.f & 0x40) ? "n" : "-");
+    cpu_register_dump << ((reg.f & 0x20) ? "h" : "-");
+    cpu_register_dump << ((reg.f & 0x10) ? "c" : "-") << "\n";
+
+    cpu_register_dump << "bc:" << std::setw(4) << std::setfill('0') << reg.bc << " ";
+    cpu_register_dump << "de:" << std::setw(4) << std::setfill('0') << reg.de << " ";
+    cpu_register_dump << "hl:" << std::setw(4) << std::setfill('0') << reg.hl << " ";
+    cpu_register_dump << "sp:" << std::setw(4) << std::setfill('0') << reg.sp << " ";
+    cpu_register_dump << "pc:" << std::setw(4) << std::setfill('0') << reg.pc << "\n";
     cpu_register_dump << std::dec;
 
     return text_to_line_vector(cpu_register_dump);
 }
 
-std::vector<std::string> Debugger::dump_memory() {
-    std::stringstream iram_dump = print_bytes(mmu.iram.begin(), mmu.iram.begin() + 256);
+std::vector<std::string> Debugger::dump_memory(const DebugSnapshot& snapshot) {
+    std::vector<uint8_t> iram(snapshot.iram, snapshot.iram + kDebuggerMemorySize);
+    std::stringstream iram_dump = print_bytes(iram);
     return text_to_line_vector(iram_dump);
 }
 
-std::vector<std::string> Debugger::dump_executed_instructions() {
+std::vector<std::string> Debugger::dump_executed_instructions(const DebugSnapshot& snapshot) {
     std::vector<std::string> lines;
-    while (!last_cpu_instructions.empty()) {
-        lines.push_back(last_cpu_instructions.front().to_string());
-        last_cpu_instructions.pop();
+    for (size_t i = 0; i < snapshot.history_size; i++) {
+        const auto& executed = snapshot.history[i];
+        lines.push_back(Instruction(executed.pc,
+            executed.bytes[0], executed.bytes[1], executed.bytes[2]).to_string());
     }
     return lines;
 }
-
-void Debugger::log_instruction() {
-    if (last_cpu_instructions.size() > 32) {
-        last_cpu_instructions.pop();
-    }
-
-    last_cpu_instructions.push(Instruction(
-        cpu.reg.pc,
-        cpu.mmu.read_byte(cpu.reg.pc),
-        cpu.mmu.read_byte(cpu.reg.pc + 1),
-        cpu.mmu.read_byte(cpu.reg.pc + 2))
-    );
-}
@@ -0,0 +1,520 @@
+/*
+ * disassembler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "disassembler.hpp"
+#include "instruction.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+const uint16_t kEntryPoints[] = {
+    0x0100,                                                 // start
+    0x0000, 0x0008, 0x0010, 0x0018, 0x0020, 0x0028, 0x0030, 0x0038, // rst
+    0x0040, 0x0048, 0x0050, 0x0058, 0x0060                  // interrupts
+};
+
+// logo, title and checksums, never jumped to
+const uint16_t kCartridgeHeaderStart = 0x0104;
+const uint16_t kCartridgeHeaderEnd   = 0x0150;
+
+const int kMaxTableEntries = 256;
+const int kDispatcherScanBytes = 16;
+
+namespace {
+
+enum Flow {
+    FLOW_NEXT,      // falls through
+    FLOW_JUMP,      // jp, jr
+    FLOW_BRANCH,    // jp cc, jr cc
+    FLOW_CALL,      // call, call cc
+    FLOW_RST,
+    FLOW_RETURN_IF, // ret cc
+    FLOW_END        // ret, reti, jp hl and invalid opcodes
+};
+
+Flow flow(uint8_t opcode) {
+    switch (opcode) {
+        case 0x18: case 0xc3:
+            return FLOW_JUMP;
+        case 0x20: case 0x28: case 0x30: case 0x38:
+        case 0xc2: case 0xca: case 0xd2: case 0xda:
+            return FLOW_BRANCH;
+        case 0xc4: case 0xcc: case 0xcd: case 0xd4: case 0xdc:
+            return FLOW_CALL;
+        case 0xc0: case 0xc8: case 0xd0: case 0xd8:
+            return FLOW_RETURN_IF;
+        case 0xc9: case 0xd9: case 0xe9:
+        case 0xd3: case 0xdb: case 0xdd: case 0xe3: case 0xe4:
+        case 0xeb: case 0xec: case 0xed: case 0xf4: case 0xfc: case 0xfd:
+            return FLOW_END;
+        default:
+            return ((opcode & 0xc7) == 0xc7) ? FLOW_RST : FLOW_NEXT;
+    }
+}
+
+uint16_t flow_target(uint16_t addr, uint8_t opcode, uint8_t arg0, uint8_t arg1) {
+    if (opcode < 0x40) {
+        return static_cast<uint16_t>(addr + 2 + static_cast<int8_t>(arg0));
+    } else if ((opcode & 0xc7) == 0xc7) {
+        return opcode & 0x38;
+    }
+    return static_cast<uint16_t>(arg0 | (arg1 << 8));
+}
+
+}
+
+GBCodeMap::GBCodeMap(uint32_t bank_count) :
+    banks(bank_count, std::vector<uint8_t>(kRomBankSize, 0)) {
+
+}
+
+size_t GBCodeMap::count(uint8_t flags) const {
+    size_t total = 0;
+    for (const auto& bank : banks) {
+        total += std::count_if(bank.begin(), bank.end(), [flags](uint8_t f) { return (f & flags) != 0; });
+    }
+    return total;
+}
+
+bool GBCodeMap::save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t header[2] = {kCodeMapVersion, static_cast<uint32_t>(banks.size())};
+    file.write(kCodeMapMagic, sizeof(kCodeMapMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    for (const auto& bank : banks) {
+        file.write(reinterpret_cast<const char*>(bank.data()), bank.size());
+    }
+    return file.good();
+}
+
+bool GBCodeMap::load(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(kCodeMapMagic)];
+    uint32_t header[2];
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, kCodeMapMagic, sizeof(magic)) != 0
+            || !file.read(reinterpret_cast<char*>(header), sizeof(header))
+            || header[0] != kCodeMapVersion) {
+        return false;
+    }
+
+    std::vector<std::vector<uint8_t>> loaded(header[1], std::vector<uint8_t>(kRomBankSize));
+    for (auto& bank : loaded) {
+        if (!file.read(reinterpret_cast<char*>(bank.data()), bank.size())) {
+            return false;
+        }
+    }
+    banks.swap(loaded);
+    return true;
+}
+
+GBDisassembler::GBDisassembler(const std::vector<uint8_t>& rom) :
+    rom(rom),
+    bank_count(std::max<uint32_t>(2, (rom.size() + kRomBankSize - 1) / kRomBankSize)),
+    code_map(), edges(), unresolved() {
+
+}
+
+uint8_t GBDisassembler::read(uint32_t bank, uint16_t addr) const {
+    size_t offset = (bank == 0) ? addr : bank * kRomBankSize + (addr - kRomBankSize);
+    return (offset < rom.size()) ? rom[offset] : 0xff;
+}
+
+bool GBDisassembler::in_bank(uint32_t bank, uint32_t addr) const {
+    return (bank == 0) ? addr < kRomBankSize : (addr >= kRomBankSize && addr < 2 * kRomBankSize);
+}
+
+// Routines like "add a ; pop hl ; ... ; jp hl" jump through the table of
+// addresses placed right after the rst that calls them
+bool GBDisassembler::is_table_dispatcher(uint16_t addr) const {
+    bool pops_hl = false;
+    for (uint16_t end = addr + kDispatcherScanBytes; addr < end; ) {
+        uint8_t opcode = read(0, addr);
+        if (opcode == 0xe1) {
+            pops_hl = true;
+        } else if (opcode == 0xe9) {
+            return pops_hl;
+        } else if (flow(opcode) != FLOW_NEXT) {
+            return false;
+        }
+        addr += Instruction::length(opcode);
+    }
+    return false;
+}
+
+void GBDisassembler::analyze_bank(uint32_t bank, std::vector<uint16_t> pending, std::vector<Target>& far) {
+    const uint8_t kClaimed = CODE_OPCODE | CODE_OPERAND | CODE_TABLE;
+
+    int32_t switched_bank = -1; // bank written to the MBC by the current run
+
+    auto resolve = [&](uint16_t target, uint32_t& to_bank) {
+        if (target < kRomBankSize) {
+            to_bank = 0;
+        } else if (target >= 2 * kRomBankSize) {
+            return false; // code in ram, copied there at run time
+        } else if (bank != 0) {
+            to_bank = bank;
+        } else if (switched_bank >= 0) {
+            to_bank = switched_bank;
+        } else if (bank_count == 2) {
+            to_bank = 1;
+        } else {
+            return false;
+        }
+        return to_bank < bank_count;
+    };
+
+    auto follow = [&](uint16_t from, uint16_t target, EdgeKind kind) {
+        uint32_t to_bank = 0;
+        if (!resolve(target, to_bank)) {
+            unresolved[bank]++;
+            return false;
+        }
+
+        edges[bank].push_back(CodeEdge{from, static_cast<uint16_t>(to_bank), target, kind});
+        uint8_t flag = (kind == EDGE_CALL) ? CODE_CALL_TARGET : CODE_JUMP_TARGET;
+        if (to_bank == bank) {
+            code_map.at(bank, target) |= flag;
+            pending.push_back(target);
+        } else {
+            far.push_back(Target{to_bank, target, flag});
+        }
+        return true;
+    };
+
+    while (!pending.empty()) {
+        uint16_t addr = pending.back();
+        pending.pop_back();
+
+        switched_bank = -1;
+        int32_t loaded_a = -1;
+        while (in_bank(bank, addr) && !(code_map.get(bank, addr) & kClaimed)) {
+            uint8_t opcode = read(bank, addr);
+            uint8_t length = Instruction::length(opcode);
+            if (!in_bank(bank, addr + length - 1)) {
+                break;
+            }
+
+            uint8_t arg0 = (length > 1) ? read(bank, addr + 1) : 0;
+            uint8_t arg1 = (length > 2) ? read(bank, addr + 2) : 0;
+            code_map.at(bank, addr) |= CODE_OPCODE;
+            for (uint8_t i = 1; i < length; i++) {
+                code_map.at(bank, addr + i) |= CODE_OPERAND;
+            }
+
+            // "ld a,n ; ld ($2000),a" selects the bank of later far jumps
+            uint16_t word = arg0 | (arg1 << 8);
+            if (opcode == 0xea && loaded_a >= 0 && word >= 0x2000 && word < 0x4000) {
+                switched_bank = (loaded_a == 0) ? 1 : loaded_a;
+            }
+            loaded_a = (opcode == 0x3e) ? arg0 : -1;
+
+            Flow kind = flow(opcode);
+            if (kind == FLOW_JUMP || kind == FLOW_BRANCH) {
+                follow(addr, flow_target(addr, opcode, arg0, arg1), kind == FLOW_JUMP ? EDGE_JUMP : EDGE_BRANCH);
+            } else if (kind == FLOW_CALL || kind == FLOW_RST) {
+                uint16_t target = flow_target(addr, opcode, arg0, arg1);
+                follow(addr, target, EDGE_CALL);
+
+                if (kind == FLOW_RST && is_table_dispatcher(target)) {
+                    // the table ends where a word doesn't look like a code
+                    // address, or runs into something already known or
+                    // into code it points to
+                    uint16_t entry = addr + 1;
+                    uint32_t table_end = 2 * kRomBankSize;
+                    for (int i = 0; i < kMaxTableEntries && entry + 1u < table_end && in_bank(bank, entry + 1);
+                            i++, entry += 2) {
+                        uint16_t jump = read(bank, entry) | (read(bank, entry + 1) << 8);
+                        if (code_map.get(bank, entry) || code_map.get(bank, entry + 1)
+                                || (jump >= kCartridgeHeaderStart && jump < kCartridgeHeaderEnd)
+                                || !follow(entry, jump, EDGE_TABLE)) {
+                            break;
+                        }
+                        code_map.at(bank, entry) |= CODE_TABLE;
+                        code_map.at(bank, entry + 1) |= CODE_OPERAND;
+                        if (jump > entry && in_bank(bank, jump)) {
+                            table_end = std::min<uint32_t>(table_end, jump);
+                        }
+                    }
+                    break;
+                }
+            }
+
+            if (kind == FLOW_JUMP || kind == FLOW_END) {
+                break;
+            }
+            addr += length;
+        }
+    }
+}
+
+void GBDisassembler::analyze(unsigned threads) {
+    code_map = GBCodeMap(bank_count);
+    edges.assign(bank_count, std::vector<CodeEdge>());
+    unresolved.assign(bank_count, 0);
+
+    std::vector<std::vector<uint16_t>> pending(bank_count);
+    for (uint16_t entry : kEntryPoints) {
+        code_map.at(0, entry) |= CODE_ENTRY;
+        pending[0].push_back(entry);
+    }
+
+    // Every round walks the banks that have new entry points in parallel,
+    // then hands the targets found in other banks over for the next one
+    while (true) {
+        std::vector<uint32_t> round;
+        for (uint32_t bank = 0; bank < bank_count; bank++) {
+            if (!pending[bank].empty()) {
+                round.push_back(bank);
+            }
+        }
+        if (round.empty()) {
+            break;
+        }
+
+        std::vector<std::vector<Target>> far(bank_count);
+        std::atomic<size_t> next(0);
+        auto worker = [&]() {
+            for (size_t i = next++; i < round.size(); i = next++) {
+                uint32_t bank = round[i];
+                analyze_bank(bank, std::move(pending[bank]), far[bank]);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        size_t workers = std::min<size_t>(std::max(1u, threads), round.size());
+        for (size_t i = 1; i < workers; i++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+
+        for (uint32_t bank = 0; bank < bank_count; bank++) {
+            pending[bank].clear();
+        }
+        for (const auto& targets : far) {
+            for (const Target& target : targets) {
+                uint8_t& flags = code_map.at(target.bank, target.addr);
+                if (!(flags & (CODE_OPCODE | CODE_OPERAND | CODE_TABLE))) {
+                    pending[target.bank].push_back(target.addr);
+                }
+                flags |= target.flag;
+            }
+        }
+    }
+
+    for (auto& bank_edges : edges) {
+        std::stable_sort(bank_edges.begin(), bank_edges.end(), [](const CodeEdge& a, const CodeEdge& b) {
+            return a.from < b.from;
+        });
+    }
+}
+
+uint32_t GBDisassembler::get_unresolved_count() const {
+    uint32_t total = 0;
+    for (uint32_t count : unresolved) {
+        total += count;
+    }
+    return total;
+}
+
+std::vector<bool> GBDisassembler::find_leaders(uint32_t bank) const {
+    std::vector<bool> leaders(kRomBankSize, false);
+    uint32_t addr = (bank == 0) ? 0 : kRomBankSize;
+    bool block_ended = true;
+    while (in_bank(bank, addr)) {
+        uint8_t flags = code_map.get(bank, addr);
+        if (!(flags & CODE_OPCODE)) {
+            block_ended = true;
+            addr += (flags & CODE_TABLE) ? 2 : 1;
+            continue;
+        }
+
+        uint8_t opcode = read(bank, addr);
+        leaders[addr & (kRomBankSize - 1)] = block_ended
+            || (flags & (CODE_ENTRY | CODE_JUMP_TARGET | CODE_CALL_TARGET));
+
+        Flow kind = flow(opcode);
+        block_ended = (kind != FLOW_NEXT && kind != FLOW_CALL && kind != FLOW_RST)
+            || (kind == FLOW_RST && is_table_dispatcher(opcode & 0x38));
+        addr += Instruction::length(opcode);
+    }
+    return leaders;
+}
+
+void GBDisassembler::write_disassembly(std::ostream& out) const {
+    char line[128];
+
+    out << "; static disassembly, " << bank_count << " banks\n";
+    out << "; " << code_map.count(CODE_OPCODE) << " instructions, "
+        << code_map.count(CODE_TABLE) << " jump table entries, "
+        << get_unresolved_count() << " jumps not followed\n";
+
+    for (uint32_t bank = 0; bank < bank_count; bank++) {
+        std::snprintf(line, sizeof(line), "\n; bank %02x\n", bank);
+        out << line;
+
+        const auto& bank_edges = edges[bank];
+        auto edges_from = [&bank_edges](uint16_t addr) {
+            return std::equal_range(bank_edges.begin(), bank_edges.end(), CodeEdge{addr, 0, 0, EDGE_JUMP},
+                [](const CodeEdge& a, const CodeEdge& b) { return a.from < b.from; });
+        };
+
+        uint32_t addr = (bank == 0) ? 0 : kRomBankSize;
+        while (in_bank(bank, addr)) {
+            uint8_t flags = code_map.get(bank, addr);
+
+            if (flags & CODE_ENTRY) {
+                std::snprintf(line, sizeof(line), "entry_%04x:\n", addr);
+                out << line;
+            } else if (flags & (CODE_CALL_TARGET | CODE_JUMP_TARGET)) {
+                std::snprintf(line, sizeof(line), "%c%02x_%04x:\n",
+                    (flags & CODE_CALL_TARGET) ? 'F' : 'L', bank, addr);
+                out << line;
+            }
+
+            if (flags & (CODE_OPCODE | CODE_TABLE)) {
+                std::string text;
+                uint8_t length = 2;
+                uint8_t opcode = read(bank, addr);
+                if (flags & CODE_OPCODE) {
+                    length = Instruction::length(opcode);
+                    Instruction instruction(addr, opcode, read(bank, addr + 1), read(bank, addr + 2));
+                    text = instruction.to_assembly();
+                } else {
+                    std::snprintf(line, sizeof(line), "dw $%02x%02x", read(bank, addr + 1), opcode);
+                    text = line;
+                }
+
+                std::snprintf(line, sizeof(line), "    %-24s ; %02x:%04x ", text.c_str(), bank, addr);
+                out << line;
+                for (uint8_t i = 0; i < length; i++) {
+                    std::snprintf(line, sizeof(line), "%02x", read(bank, addr + i));
+                    out << line;
+                }
+                auto range = edges_from(addr);
+                for (auto edge = range.first; edge != range.second; ++edge) {
+                    std::snprintf(line, sizeof(line), " -> %02x:%04x", edge->to_bank, edge->to);
+                    out << line;
+                }
+                out << "\n";
+                addr += length;
+                continue;
+            }
+
+            // data up to the next known byte, long fills folded into ds
+            uint32_t end = addr + 1;
+            while (in_bank(bank, end) && !code_map.get(bank, end)) {
+                end++;
+            }
+
+            uint8_t value = read(bank, addr);
+            uint32_t same = addr + 1;
+            while (same < end && read(bank, same) == value) {
+                same++;
+            }
+            if (same - addr >= 16) {
+                std::snprintf(line, sizeof(line), "    ds %u,$%02x\n", same - addr, value);
+                out << line;
+                addr = same;
+                continue;
+            }
+
+            out << "    db ";
+            uint32_t stop = std::min(end, addr + 8);
+            for (uint32_t i = addr; i < stop; i++) {
+                std::snprintf(line, sizeof(line), "%s$%02x", i == addr ? "" : ",", read(bank, i));
+                out << line;
+            }
+            out << "\n";
+            addr = stop;
+        }
+    }
+}
+
+void GBDisassembler::write_cfg(std::ostream& out) const {
+    char line[128];
+
+    out << "digraph rom {\n";
+    out << "    node [shape=box fontname=monospace];\n";
+
+    for (uint32_t bank = 0; bank < bank_count; bank++) {
+        std::vector<bool> leaders = find_leaders(bank);
+        std::vector<uint16_t> block_of(kRomBankSize, 0);
+
+        // blocks and the fall through between them
+        uint32_t addr = (bank == 0) ? 0 : kRomBankSize;
+        uint32_t block = 0;
+        uint32_t instructions = 0;
+        bool open = false;
+        bool falls_through = false;
+        auto close_block = [&]() {
+            if (open) {
+                std::snprintf(line, sizeof(line), "    \"%02x:%04x\" [label=\"%02x:%04x\\n%u instructions\"];\n",
+                    bank, block, bank, block, instructions);
+                out << line;
+            }
+            open = false;
+        };
+
+        while (in_bank(bank, addr)) {
+            uint8_t flags = code_map.get(bank, addr);
+            if (!(flags & CODE_OPCODE)) {
+                close_block();
+                falls_through = false;
+                addr += 1;
+                continue;
+            }
+
+            if (leaders[addr & (kRomBankSize - 1)]) {
+                close_block();
+                if (falls_through) {
+                    std::snprintf(line, sizeof(line), "    \"%02x:%04x\" -> \"%02x:%04x\" [style=dotted];\n",
+                        bank, block, bank, addr);
+                    out << line;
+                }
+                block = addr;
+                instructions = 0;
+                open = true;
+            }
+
+            uint8_t opcode = read(bank, addr);
+            Flow kind = flow(opcode);
+            block_of[addr & (kRomBankSize - 1)] = block;
+            instructions++;
+            falls_through = kind != FLOW_JUMP && kind != FLOW_END
+                && !(kind == FLOW_RST && is_table_dispatcher(opcode & 0x38));
+            addr += Instruction::length(opcode);
+        }
+        close_block();
+
+        static const char* kEdgeStyles[] = {"", " [color=darkgreen]", " [style=dashed]", " [style=bold]"};
+        for (const CodeEdge& edge : edges[bank]) {
+            // table entries belong to the block of the rst in front of them
+            uint16_t from = edge.from;
+            if (edge.kind == EDGE_TABLE) {
+                while (!(code_map.get(bank, from) & CODE_OPCODE) && from > ((bank == 0) ? 0 : kRomBankSize)) {
+                    from--;
+                }
+            }
+            std::snprintf(line, sizeof(line), "    \"%02x:%04x\" -> \"%02x:%04x\"%s;\n",
+                bank, block_of[from & (kRomBankSize - 1)], edge.to_bank, edge.to, kEdgeStyles[edge.kind]);
+            out << line;
+        }
+    }
+
+    out << "}\n";
+}
@@ -0,0 +1,160 @@
+/*
+ * frame_pacer.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using std::chrono::microseconds;
+
+const microseconds kMinSpinMargin(200);
+const microseconds kMaxSpinMargin(2000);
+const int kMaxLagFrames = 3;
+const std::chrono::seconds kMeasureWindow(1);
+
+bool parse_pacing_mode(const std::string& name, PacingMode& mode) {
+    if (name == "realtime") {
+        mode = PACE_REALTIME;
+    } else if (name == "vsync") {
+        mode = PACE_VSYNC;
+    } else if (name == "uncapped") {
+        mode = PACE_UNCAPPED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+FramePacer::FramePacer(PacingMode mode, tick_t ticks_per_frame) :
+    mode(mode), speed(1),
+    lcd_frame_duration(std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(ticks_per_frame) / kTicksPerSecond))),
+    frame_duration(lcd_frame_duration),
+    deadline(), spin_margin(kMinSpinMargin * 5), started(false), paused(false),
+    frame_count(0), late_frames(0),
+    window_start(Clock::now()), window_frames(0), measured_speed(0),
+    vsync_count(0), vsync_seen(0) {
+
+}
+
+void FramePacer::set_mode(PacingMode mode) {
+    this->mode = mode;
+    started = false;
+}
+
+void FramePacer::set_speed(double speed) {
+    this->speed = speed > 0 ? speed : 0;
+    if (this->speed > 0) {
+        frame_duration = std::chrono::duration_cast<Clock::duration>(lcd_frame_duration / this->speed);
+    }
+    started = false;
+}
+
+void FramePacer::wait_frame() {
+    frame_count++;
+    if (!paused && mode != PACE_UNCAPPED && speed > 0) {
+        if (mode == PACE_VSYNC && speed == 1) {
+            wait_vsync();
+        } else {
+            wait_deadline();
+        }
+    }
+    measure();
+}
+
+void FramePacer::measure() {
+    window_frames++;
+
+    Clock::time_point now = Clock::now();
+    Clock::duration elapsed = now - window_start;
+    if (elapsed >= kMeasureWindow) {
+        measured_speed = window_frames * std::chrono::duration<double>(lcd_frame_duration).count()
+            / std::chrono::duration<double>(elapsed).count();
+        window_start = now;
+        window_frames = 0;
+    }
+}
+
+void FramePacer::wait_deadline() {
+    Clock::time_point now = Clock::now();
+    if (!started) {
+        deadline = now;
+        started = true;
+    }
+
+    deadline += frame_duration;
+    if (now >= deadline) {
+        late_frames++;
+        if (now - deadline > kMaxLagFrames * frame_duration) {
+            deadline = now;
+        }
+        return;
+    }
+
+    // sleep the coarse part, the scheduler may wake us late by about the
+    // margin, then spin to the deadline
+    Clock::time_point wake = deadline - spin_margin;
+    if (now < wake) {
+        std::this_thread::sleep_until(wake);
+        Clock::duration overshoot = Clock::now() - wake;
+        Clock::duration target = std::max<Clock::duration>(kMinSpinMargin,
+            std::min<Clock::duration>(kMaxSpinMargin, overshoot * 2));
+        spin_margin = (spin_margin * 7 + target) / 8;
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::wait_vsync() {
+    Clock::time_point now = Clock::now();
+    if (!started) {
+        deadline = now;
+        started = true;
+    }
+    deadline += frame_duration;
+
+    // the clock deadline keeps running so that without refreshes, e.g.
+    // with the window hidden, frames still come at the realtime rate
+    std::unique_lock<std::mutex> lock(vsync_mutex);
+    bool refreshed = vsync_signal.wait_until(lock, deadline + frame_duration / 2, [this] {
+        return vsync_count != vsync_seen;
+    });
+
+    if (refreshed) {
+        vsync_seen = vsync_count;
+        deadline = Clock::now();
+    } else if (now - deadline > kMaxLagFrames * frame_duration) {
+        late_frames++;
+        deadline = now;
+    }
+}
+
+void FramePacer::pause() {
+    paused = true;
+}
+
+void FramePacer::resume() {
+    paused = false;
+    started = false;
+
+    window_start = Clock::now();
+    window_frames = 0;
+
+    std::lock_guard<std::mutex> lock(vsync_mutex);
+    vsync_seen = vsync_count;
+}
+
+void FramePacer::vsync() {
+    {
+        std::lock_guard<std::mutex> lock(vsync_mutex);
+        vsync_count++;
+    }
+    vsync_signal.notify_one();
+}
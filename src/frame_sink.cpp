@@ -0,0 +1,79 @@
+/*
+ * frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "frame_sink.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void expand_shades(const uint8_t* shades, uint32_t* pixels, int count) {
+    for (int i = 0; i < count; i++) {
+        pixels[i] = kShadePalette[shades[i] & 0x3];
+    }
+}
+
+bool find_changed_rows(const uint8_t* previous, const uint8_t* shades,
+        int& first_row, int& last_row) {
+    int first = 0;
+    while (first < kScreenHeight &&
+           std::memcmp(previous + first * kScreenWidth,
+                       shades + first * kScreenWidth, kScreenWidth) == 0) {
+        first++;
+    }
+
+    if (first == kScreenHeight) {
+        return false;
+    }
+
+    int last = kScreenHeight - 1;
+    while (last > first &&
+           std::memcmp(previous + last * kScreenWidth,
+                       shades + last * kScreenWidth, kScreenWidth) == 0) {
+        last--;
+    }
+
+    first_row = first;
+    last_row = last;
+    return true;
+}
+
+MemoryFrameSink::MemoryFrameSink(FrameSink* next) :
+    frame(kScreenSize, 0), frame_count(0), timestamp(0), next(next) {
+
+}
+
+void MemoryFrameSink::present(const uint8_t* shades, uint64_t timestamp) {
+    std::copy(shades, shades + kScreenSize, frame.begin());
+    frame_count += 1;
+    this->timestamp = timestamp;
+
+    if (next) {
+        next->present(shades, timestamp);
+    }
+}
+
+FileFrameSink::FileFrameSink(const std::string& filename) :
+    file(filename, std::ofstream::out | std::ofstream::binary),
+    rgb(kScreenSize * 3, 0) {
+
+}
+
+void FileFrameSink::present(const uint8_t* shades, uint64_t timestamp) {
+    if (!file.is_open()) {
+        return;
+    }
+
+    for (int i = 0; i < kScreenSize; i++) {
+        uint32_t color = kShadePalette[shades[i] & 0x3];
+        rgb[i * 3 + 0] = static_cast<uint8_t>(color >> 16);
+        rgb[i * 3 + 1] = static_cast<uint8_t>(color >> 8);
+        rgb[i * 3 + 2] = static_cast<uint8_t>(color >> 0);
+    }
+
+    file << "P6\n" << kScreenWidth << " " << kScreenHeight << "\n255\n";
+    file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+}
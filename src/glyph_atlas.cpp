@@ -0,0 +1,80 @@
+/*
+ * glyph_atlas.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "glyph_atlas.hpp"
+
+#include <iostream>
+
+const char kFirstGlyph = ' ';
+const char kLastGlyph  = '~';
+const int  kGlyphCount = kLastGlyph - kFirstGlyph + 1;
+const int  kGlyphsPerRow = 16;
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer* renderer, TTF_Font* font,
+        SDL_Color foreground, SDL_Color background) :
+    texture(nullptr), glyph_width(0), line_height(0) {
+
+    int advance = 0;
+    if (TTF_GlyphMetrics(font, 'M', nullptr, nullptr, nullptr, nullptr, &advance) != 0) {
+        std::cerr << "TTF_GlyphMetrics failed: " << TTF_GetError() << "\n";
+        return;
+    }
+    glyph_width = advance;
+    line_height = TTF_FontLineSkip(font);
+
+    int rows = (kGlyphCount + kGlyphsPerRow - 1) / kGlyphsPerRow;
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0,
+        kGlyphsPerRow * glyph_width, rows * line_height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!atlas) {
+        std::cerr << "SDL_CreateRGBSurfaceWithFormat failed: " << SDL_GetError() << "\n";
+        return;
+    }
+
+    SDL_FillRect(atlas, nullptr, SDL_MapRGB(atlas->format, background.r, background.g, background.b));
+
+    for (int i = 0; i < kGlyphCount; i++) {
+        SDL_Surface* glyph = TTF_RenderGlyph_Shaded(font, kFirstGlyph + i, foreground, background);
+        if (!glyph) {
+            continue;
+        }
+
+        // cells are one advance wide, anything past it belongs to no glyph
+        SDL_Rect source = {0, 0, glyph_width, line_height};
+        SDL_Rect cell = {(i % kGlyphsPerRow) * glyph_width, (i / kGlyphsPerRow) * line_height,
+            glyph_width, line_height};
+        SDL_BlitSurface(glyph, &source, atlas, &cell);
+        SDL_FreeSurface(glyph);
+    }
+
+    texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    if (!texture) {
+        std::cerr << "SDL_CreateTextureFromSurface failed: " << SDL_GetError() << "\n";
+    }
+    SDL_FreeSurface(atlas);
+}
+
+GlyphAtlas::~GlyphAtlas() {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+void GlyphAtlas::draw_text(SDL_Renderer* renderer, const std::string& text, int x, int y) const {
+    if (!texture) {
+        return;
+    }
+
+    SDL_Rect source = {0, 0, glyph_width, line_height};
+    SDL_Rect target = {x, y, glyph_width, line_height};
+    for (char c : text) {
+        int i = (c >= kFirstGlyph && c <= kLastGlyph) ? c - kFirstGlyph : 0;
+        source.x = (i % kGlyphsPerRow) * glyph_width;
+        source.y = (i / kGlyphsPerRow) * line_height;
+        SDL_RenderCopy(renderer, texture, &source, &target);
+        target.x += glyph_width;
+    }
+}
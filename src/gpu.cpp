@@ -1,5 +1,7 @@
 #include "gpu.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <string>
@@ -14,136 +16,134 @@ const uint16_t kTileHeight = 8;
 const uint16_t kTilesPerRow = 32;
 const uint16_t kTilesPerColumn = 32;
 
-// WHITE
-#define SHADE_0 0xFF9BBC0F
-// LIGHT GRAY
-#define SHADE_1 0xFF8BAC0F
-// DARK GRAY
-#define SHADE_2 0xFF306230
-// BLACK
-#define SHADE_3 0xFF0f380f
+const uint16_t kVideoRamBase = 0x8000;
+const uint16_t kObjectRamBase = 0xfe00;
 
-#define R(color) static_cast<Uint8>(color >> 16)
-#define G(color) static_cast<Uint8>(color >> 8)
-#define B(color) static_cast<Uint8>(color >> 0)
+const tick_t kTicksReadOAM   = 80;
+const tick_t kTicksWriteVRAM = 172;
+const tick_t kTicksHBlank    = 204;
+const tick_t kTicksPerLine   = kTicksReadOAM + kTicksWriteVRAM + kTicksHBlank;
+
+const uint8_t kLastVisibleLine = 142;
+const uint8_t kLastVBlankLine  = 153;
 
-GBGPU::GBGPU(GBMMU& mmu) :
-    window(nullptr), renderer(nullptr), texture(nullptr), clock(0), mmu(mmu) {
 
+GBGPU::GBGPU(GBMMU& mmu) :
+    framebuffer(SCREEN_SIZE, 0), sink(nullptr), clock(0), emulated_ticks(0), pending_ticks(0), sync_deadline(0),
+    frame_open(false), latched_lines(0), rendered_lines(0),
+    line_state(), raster_log(), raster_log_cursor(0),
+    frame_skip(1), frame_counter(0), frame_requested(false), frame_rendering(true),
+    dirty_frames(1), reused_frames(0), mmu(mmu) {
+
+    raster_log.reserve(256);
+    mmu.set_video_observer(this);
 }
 
 GBGPU::~GBGPU() {
-    framebuffer.clear();
-
-    if (texture) {
-        SDL_DestroyTexture(texture);
-    }
-
-    if (renderer) {
-        SDL_DestroyRenderer(renderer);
-    }
+    mmu.set_video_observer(nullptr);
 
-    if (window) {
-        SDL_DestroyWindow(window);
-    }
+    framebuffer.clear();
 }
 
-void GBGPU::show() {
-    if (!window) {
-        window = SDL_CreateWindow(window_title.c_str(),
-            SDL_WINDOWPOS_UNDEFINED,
-            SDL_WINDOWPOS_UNDEFINED,
-            SCREEN_WIDTH,
-            SCREEN_HEIGHT,
-            SDL_WINDOW_SHOWN);
-
-        if (window) {
-            renderer = SDL_CreateRenderer(window, -1, 0);
-            texture  = SDL_CreateTexture(renderer,
-                SDL_PIXELFORMAT_ARGB8888,
-                SDL_TEXTUREACCESS_STREAMING,
-                SCREEN_WIDTH, SCREEN_HEIGHT);
-            framebuffer = std::vector<Uint32>(SCREEN_SIZE, SHADE_0);
-            black();
-        } else {
-            std::cerr << "SDL_CreateWindow failed: " << SDL_GetError() << "\n";
-        }
-    }
+// more register writes than a frame has ticks can't happen
+const uint32_t kMaxRasterEvents = kTicksPerLcdFrame;
+
+void GBGPU::save_state(GBStateWriter& writer) const {
+    writer.write_tag("GPU ");
+    writer.write(clock);
+    writer.write(emulated_ticks);
+    writer.write(pending_ticks);
+    writer.write(sync_deadline);
+
+    writer.write(frame_open);
+    writer.write(latched_lines);
+    writer.write(rendered_lines);
+    writer.write(line_state);
+    writer.write_vector(raster_log);
+    writer.write(static_cast<uint32_t>(raster_log_cursor));
+
+    writer.write(frame_counter);
+    writer.write(frame_requested);
+    writer.write(frame_rendering);
+    writer.write(dirty_frames);
+
+    writer.write_vector(framebuffer);
 }
 
-void GBGPU::hide() {
-    if (texture) {
-        SDL_DestroyTexture(texture);
-        texture = nullptr;
-    }
-
-    if (renderer) {
-        SDL_DestroyRenderer(renderer);
-        renderer = nullptr;
-    }
-
-    if (window) {
-        SDL_DestroyWindow(window);
-        window = nullptr;
+void GBGPU::load_state(GBStateReader& reader) {
+    reader.read_tag("GPU ");
+    reader.read(clock);
+    reader.read(emulated_ticks);
+    reader.read(pending_ticks);
+    reader.read(sync_deadline);
+
+    reader.read(frame_open);
+    reader.read(latched_lines);
+    reader.read(rendered_lines);
+    reader.read(line_state);
+    reader.read_list(raster_log, kMaxRasterEvents);
+    uint32_t cursor = 0;
+    reader.read(cursor);
+    raster_log_cursor = cursor;
+
+    reader.read(frame_counter);
+    reader.read(frame_requested);
+    reader.read(frame_rendering);
+    reader.read(dirty_frames);
+
+    reader.read_vector(framebuffer);
+
+    if (latched_lines < 0 || latched_lines > SCREEN_HEIGHT || rendered_lines < 0 ||
+        rendered_lines > latched_lines || raster_log_cursor > raster_log.size()) {
+        reader.fail("save state frame is inconsistent");
     }
 }
 
-void GBGPU::blank() {
-    if (!texture || !renderer || !window) {
-        return;
-    }
-
-    SDL_SetRenderDrawColor(renderer, R(SHADE_0), G(SHADE_0), B(SHADE_0), 0xff);
-    SDL_RenderClear(renderer);
-    SDL_RenderPresent(renderer);
+void GBGPU::set_frame_sink(FrameSink* sink) {
+    this->sink = sink;
 }
 
-void GBGPU::black() {
-    if (!texture || !renderer || !window) {
-        return;
-    }
-
-    SDL_SetRenderDrawColor(renderer, R(SHADE_3), G(SHADE_3), B(SHADE_3), 0xff);
-    SDL_RenderClear(renderer);
-    SDL_RenderPresent(renderer);
+void GBGPU::set_frame_skip(uint32_t n) {
+    frame_skip = n;
 }
 
-void GBGPU::renderscan() {
-    int scanline  = static_cast<int>(mmu.hwio_ly);
+void GBGPU::request_frame() {
+    frame_requested = true;
+}
 
+void GBGPU::renderscan(const int scanline, const GBRasterState& state) {
     clear_scanline(scanline);
 
-    if (mmu.hwio_lcdc & LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE) {
-        render_background_scanline(scanline);
+    if (state.lcdc & LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE) {
+        render_background_scanline(scanline, state);
     }
 
-    if (mmu.hwio_lcdc & LCDC_FLAG_SPRITE_DISPLAY_ENABLE) {
-        render_sprite_scanline(scanline);
+    if (state.lcdc & LCDC_FLAG_SPRITE_DISPLAY_ENABLE) {
+        render_sprite_scanline(scanline, state);
     }
 }
-const Uint32 kShadePalette[4] = {SHADE_0, SHADE_1, SHADE_2, SHADE_3};
 
 void GBGPU::clear_scanline(const int scanline) {
     int line_begin = scanline * SCREEN_WIDTH;
     int line_end = line_begin + SCREEN_WIDTH;
-    std::fill(framebuffer.begin() + line_begin, framebuffer.begin() + line_end, SHADE_0);
+    std::fill(framebuffer.begin() + line_begin, framebuffer.begin() + line_end, 0);
 }
 
-void GBGPU::render_background_scanline(const int scanline) {
-    int offset_line = mmu.hwio_scy;
+void GBGPU::render_background_scanline(const int scanline, const GBRasterState& state) {
+    int offset_line = state.scy;
 
     int line = (scanline + offset_line) % 256;
 
-    uint16_t bg_addr = (mmu.hwio_lcdc & LCDC_FLAG_BACKGROUND_TILE_MAP_DISPLAY_SELECT)
+    uint16_t bg_addr = (state.lcdc & LCDC_FLAG_BACKGROUND_TILE_MAP_DISPLAY_SELECT)
         ? 0x9c00 : 0x9800;
 
     for (int column = 0; column < SCREEN_WIDTH; column++) {
         uint16_t bg_index = (line / kTileHeight) * kTilesPerRow;
         bg_index += (column / kTileWidth);
 
-        uint16_t tile_number = mmu.read_byte(bg_addr + bg_index);
+        uint16_t tile_number = mmu.vram[bg_addr + bg_index - kVideoRamBase];
 
-        uint16_t tile_addr = (mmu.hwio_lcdc & LCDC_FLAG_BACKGROUND_WINDOW_TILE_DATA_SELECT)
+        uint16_t tile_addr = (state.lcdc & LCDC_FLAG_BACKGROUND_WINDOW_TILE_DATA_SELECT)
             ? 0x8000 : 0x9000;
 
         if (tile_addr == 0x9000 && tile_number >= 128) {
@@ -154,8 +154,8 @@ void GBGPU::render_background_scanline(const int scanline) {
         }
         tile_addr += (line % kTileHeight) * 2;
 
-        uint8_t lsb = mmu.read_byte(tile_addr + 0);
-        uint8_t msb = mmu.read_byte(tile_addr + 1);
+        uint8_t lsb = mmu.vram[tile_addr + 0 - kVideoRamBase];
+        uint8_t msb = mmu.vram[tile_addr + 1 - kVideoRamBase];
 
         int bit_index = 7 - (column % 8);
 
@@ -163,19 +163,19 @@ void GBGPU::render_background_scanline(const int scanline) {
         pallete_index += ((lsb >> bit_index) & 0x01) ? 2 : 0;
         pallete_index += ((msb >> bit_index) & 0x01) ? 1 : 0;
 
-        pallete_index = (mmu.hwio_bgp >> (pallete_index * 2)) & 0x3;
+        pallete_index = (state.bgp >> (pallete_index * 2)) & 0x3;
 
         int pos = column + (scanline * SCREEN_WIDTH);
-        framebuffer.at(pos) = kShadePalette[pallete_index];
+        framebuffer.at(pos) = pallete_index;
     }
 }
 
 const uint16_t kSizeSprite = 4;
 
-void GBGPU::render_sprite_scanline(const int scanline) {
+void GBGPU::render_sprite_scanline(const int scanline, const GBRasterState& state) {
     uint16_t render_line = scanline;
 
-    bool is8x16 = mmu.hwio_lcdc & LCDC_FLAG_SPRITE_SIZE;
+    bool is8x16 = state.lcdc & LCDC_FLAG_SPRITE_SIZE;
     const uint8_t kSpriteWidth = 8;
     const uint8_t kSpriteHeight = (is8x16) ? 16 : 8;
 
@@ -213,10 +213,10 @@ void GBGPU::render_sprite_scanline(const int scanline) {
 
         uint16_t tileLineAddress = tileAddress + (tileLine * kSpriteTileLineSize);
 
-        uint8_t lsb = mmu.read_byte(tileLineAddress);
-        uint8_t msb = mmu.read_byte(tileLineAddress + 1);
+        uint8_t lsb = mmu.vram[tileLineAddress - kVideoRamBase];
+        uint8_t msb = mmu.vram[tileLineAddress + 1 - kVideoRamBase];
 
-        uint8_t sprite_pallete = sprite->is_pallet1() ? mmu.hwio_obp1 : mmu.hwio_obp0;
+        uint8_t sprite_pallete = sprite->is_pallet1() ? state.obp1 : state.obp0;
 
         for (int i = 0; i < kSpriteWidth; i++) {
             if ((sprite->x + i) < kSpriteWidth || (sprite->screenX() + i) >= SCREEN_WIDTH) {
@@ -236,7 +236,7 @@ void GBGPU::render_sprite_scanline(const int scanline) {
             int pos = column + (scanline * SCREEN_WIDTH);
 
             if (pallete_index != 0) {
-                framebuffer.at(pos) = kShadePalette[pallete_index];
+                framebuffer.at(pos) = pallete_index;
             }
         }
     }
@@ -261,39 +261,39 @@ uint16_t GBGPU::decode_background_address(const uint8_t line, const uint8_t colu
 }
 
 void GBGPU::refresh() {
-    if (mmu.hwio_lcdc & 0x80) {
-        int pitch = 0;
-        Uint32* pixels = nullptr;
-        SDL_LockTexture(texture, nullptr,
-            reinterpret_cast<void **>(&pixels), &pitch);
-
-        std::copy(framebuffer.begin(), framebuffer.end(), pixels);
-
-        SDL_UnlockTexture(texture);
-
-        SDL_RenderClear(renderer);
-        SDL_RenderCopy(renderer, texture, NULL, NULL);
-        SDL_RenderPresent(renderer);
+    if ((mmu.hwio_lcdc & 0x80) && sink) {
+        // clock is how far the step went past the end of the frame
+        sink->present(framebuffer.data(), emulated_ticks - clock);
     }
 }
 
-void GBGPU::step(uint8_t elapsed_ticks) {
+void GBGPU::step(tick_t elapsed_ticks) {
     clock += elapsed_ticks;
+    emulated_ticks += elapsed_ticks;
 
     GPUMode mode = static_cast<GPUMode>(mmu.hwio_stat & 0x3);
 
     switch (mode) {
         case HBLANK:
-            if (clock >= 204) {
-                clock -= 204;
+            if (clock >= kTicksHBlank) {
+                clock -= kTicksHBlank;
                 mmu.hwio_ly += 1;
                 mmu.check_lcdc_line_coincidence();
 
-                if (mmu.hwio_ly >= 143) {
+                if (mmu.hwio_ly > kLastVisibleLine) {
                     mode = VBLANK;
                     mmu.request_interrupt(INTERRUPT_VBLANK);
                     mmu.request_lcdc_interrupt(LCDC_INTERRUPT_VBLANK);
-                    refresh();
+                    if (frame_rendering) {
+                        if (dirty_frames > 0) {
+                            render_latched_scanlines();
+                            dirty_frames -= 1;
+                        } else {
+                            reused_frames += 1;
+                        }
+                        refresh();
+                    }
+                    frame_open = false;
                 } else {
                     mode = READOAM;
                     mmu.request_lcdc_interrupt(LCDC_INTERRUPT_OAM);
@@ -302,11 +302,11 @@ void GBGPU::step(uint8_t elapsed_ticks) {
             }
             break;
         case VBLANK:
-            if (clock >= 456) {
-                clock -= 456;
+            if (clock >= kTicksPerLine) {
+                clock -= kTicksPerLine;
                 mmu.hwio_ly += 1;
 
-                if (mmu.hwio_ly > 153) {
+                if (mmu.hwio_ly > kLastVBlankLine) {
                     mode = READOAM;
                     mmu.request_lcdc_interrupt(LCDC_INTERRUPT_OAM);
                     mmu.hwio_ly = 0;
@@ -316,17 +316,17 @@ void GBGPU::step(uint8_t elapsed_ticks) {
             }
             break;
         case READOAM:
-            if (clock >= 80) {
-                clock -= 80;
+            if (clock >= kTicksReadOAM) {
+                clock -= kTicksReadOAM;
                 mode = WRIVRAM;
             }
             break;
         case WRIVRAM:
-            if (clock >= 172) {
-                clock -= 172;
+            if (clock >= kTicksWriteVRAM) {
+                clock -= kTicksWriteVRAM;
                 mode = HBLANK;
                 mmu.request_lcdc_interrupt(LCDC_INTERRUPT_HBLANK);
-                renderscan();
+                latch_scanline();
             }
             break;
     }
@@ -334,9 +334,223 @@ void GBGPU::step(uint8_t elapsed_ticks) {
     mmu.hwio_stat = (mmu.hwio_stat & 0xfc) | (mode & 0x03);
 }
 
-void GBGPU::set_window_title(const std::string& title) {
-    window_title = title;
-    if (window) {
-        SDL_SetWindowTitle(window, window_title.c_str());
+void GBGPU::sync() {
+    while (pending_ticks > 0) {
+        tick_t elapsed = std::min(pending_ticks, ticks_to_next_mode());
+        pending_ticks -= elapsed;
+        step(elapsed);
+    }
+    sync_deadline = ticks_to_next_event();
+}
+
+tick_t GBGPU::ticks_to_next_mode() const {
+    tick_t length = 0;
+    switch (static_cast<GPUMode>(mmu.hwio_stat & 0x3)) {
+        case HBLANK:
+            length = kTicksHBlank;
+            break;
+        case VBLANK:
+            length = kTicksPerLine;
+            break;
+        case READOAM:
+            length = kTicksReadOAM;
+            break;
+        case WRIVRAM:
+            length = kTicksWriteVRAM;
+            break;
+    }
+    return (clock < length) ? (length - clock) : 0;
+}
+
+tick_t GBGPU::ticks_to_line(uint8_t line) const {
+    // every line, visible or not, lasts kTicksPerLine
+    tick_t line_offset = clock;
+    switch (static_cast<GPUMode>(mmu.hwio_stat & 0x3)) {
+        case HBLANK:
+            line_offset += kTicksReadOAM + kTicksWriteVRAM;
+            break;
+        case WRIVRAM:
+            line_offset += kTicksReadOAM;
+            break;
+        default:
+            break;
+    }
+
+    tick_t frame_offset = mmu.hwio_ly * kTicksPerLine + line_offset;
+    tick_t line_start = line * kTicksPerLine;
+    if (line_start > frame_offset) {
+        return line_start - frame_offset;
+    }
+    return line_start + kTicksPerLcdFrame - frame_offset;
+}
+
+tick_t GBGPU::ticks_to_next_event() const {
+    tick_t next_mode = ticks_to_next_mode();
+
+    // hblank and oam STAT interrupts may be raised on any mode change
+    if (next_mode == 0 || mmu.hwio_ly > kLastVBlankLine ||
+        (mmu.hwio_stat & (kLcdInterruptHBlank | kLcdInterruptOAM))) {
+        return next_mode;
+    }
+
+    // otherwise only vblank and the LY=LYC coincidence are due
+    tick_t deadline = ticks_to_line(kLastVisibleLine + 1);
+    if (mmu.hwio_lyc <= kLastVBlankLine) {
+        deadline = std::min(deadline, ticks_to_line(mmu.hwio_lyc));
+    }
+    return deadline;
+}
+
+GBRasterState GBGPU::get_raster_state() const {
+    GBRasterState state;
+    state.lcdc = mmu.hwio_lcdc;
+    state.scy  = mmu.hwio_scy;
+    state.scx  = mmu.hwio_scx;
+    state.bgp  = mmu.hwio_bgp;
+    state.obp0 = mmu.hwio_obp0;
+    state.obp1 = mmu.hwio_obp1;
+    state.wy   = mmu.hwio_wy;
+    state.wx   = mmu.hwio_wx;
+    return state;
+}
+
+void apply_raster_event(GBRasterState& state, const GBRasterEvent& event) {
+    switch (event.addr) {
+        case kAddrLCDC:
+            state.lcdc = event.value;
+            break;
+        case kAddrSCY:
+            state.scy = event.value;
+            break;
+        case kAddrSCX:
+            state.scx = event.value;
+            break;
+        case kAddrBGP:
+            state.bgp = event.value;
+            break;
+        case kAddrOBP0:
+            state.obp0 = event.value;
+            break;
+        case kAddrOBP1:
+            state.obp1 = event.value;
+            break;
+        case kAddrWY:
+            state.wy = event.value;
+            break;
+        case kAddrWX:
+            state.wx = event.value;
+            break;
     }
 }
+
+void GBGPU::open_frame() {
+    line_state = get_raster_state();
+    raster_log.clear();
+    raster_log_cursor = 0;
+    latched_lines = 0;
+    rendered_lines = 0;
+    frame_open = true;
+
+    frame_counter += 1;
+    frame_rendering = frame_requested || (frame_skip != 0 && (frame_counter % frame_skip) == 0);
+    frame_requested = false;
+}
+
+void GBGPU::latch_scanline() {
+    if (!frame_open) {
+        open_frame();
+    }
+
+    if (latched_lines < SCREEN_HEIGHT) {
+        latched_lines += 1;
+    }
+}
+
+void GBGPU::render_latched_scanlines() {
+    if (raster_log_cursor == raster_log.size()) {
+        // no raster effects pending, all lines share the same registers
+        for (int line = rendered_lines; line < latched_lines; line++) {
+            renderscan(line, line_state);
+        }
+    } else {
+        for (int line = rendered_lines; line < latched_lines; line++) {
+            while (raster_log_cursor < raster_log.size() &&
+                   raster_log[raster_log_cursor].line <= line) {
+                apply_raster_event(line_state, raster_log[raster_log_cursor++]);
+            }
+            renderscan(line, line_state);
+        }
+    }
+    rendered_lines = latched_lines;
+}
+
+void GBGPU::mark_frame_dirty() {
+    uint8_t frames = (frame_open && latched_lines > 0) ? 2 : 1;
+    dirty_frames = std::max(dirty_frames, frames);
+}
+
+void GBGPU::video_memory_write(uint16_t addr, uint8_t value) {
+    sync();
+
+    uint8_t previous = (addr >= kObjectRamBase)
+        ? mmu.oram[addr - kObjectRamBase] : mmu.vram[addr - kVideoRamBase];
+    if (previous == value) {
+        return;
+    }
+    mark_frame_dirty();
+
+    // latched lines must see vram/oam as it was when they were scanned
+    if (frame_rendering && rendered_lines < latched_lines) {
+        render_latched_scanlines();
+    }
+}
+
+void GBGPU::lcd_register_write(uint16_t addr, uint8_t value) {
+    sync();
+
+    // the write may move the next interrupt (STAT, LY, LYC...)
+    sync_deadline = 0;
+
+    switch (addr) {
+        case kAddrLCDC:
+        case kAddrSCY:
+        case kAddrSCX:
+        case kAddrBGP:
+        case kAddrOBP0:
+        case kAddrOBP1:
+        case kAddrWY:
+        case kAddrWX:
+            break;
+        default:
+            return;
+    }
+
+    // a write during vblank belongs to the next frame, open it first so
+    // the event lands on its first line and not past the last one
+    if (!frame_open) {
+        open_frame();
+    }
+
+    GBRasterEvent event;
+    event.line  = static_cast<uint8_t>(latched_lines);
+    event.value = value;
+    event.addr  = addr;
+
+    GBRasterState state = get_raster_state();
+    GBRasterState next_state = state;
+    apply_raster_event(next_state, event);
+    if (std::memcmp(&state, &next_state, sizeof(GBRasterState)) == 0) {
+        return;
+    }
+    mark_frame_dirty();
+
+    if (!frame_rendering) {
+        return;
+    }
+
+    raster_log.push_back(event);
+}
+
+void GBGPU::lcd_register_read(uint16_t addr) {
+    sync();
+}
@@ -0,0 +1,53 @@
+/*
+ * hash_frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "hash_frame_sink.hpp"
+#include "utils.hpp"
+
+#include <cstdio>
+
+HashFrameSink::HashFrameSink(const std::string& filename, const GBCPU* cpu, FrameSink* next) :
+    file(filename, std::ofstream::out), cpu(cpu), next(next),
+    frames_written(0), frames_presented(0), last_hash(0) {
+
+}
+
+void HashFrameSink::present(const uint8_t* shades, uint64_t timestamp) {
+    last_hash = hash64(shades, kScreenSize);
+    frames_presented += 1;
+
+    if (next) {
+        next->present(shades, timestamp);
+    }
+}
+
+void HashFrameSink::write_frame() {
+    if (file.is_open()) {
+        char line[96];
+        if (cpu) {
+            const GBMMU& mmu = cpu->mmu;
+            const uint8_t interrupts[] = {mmu.interrupt_master_enabled, mmu.hwio_ie, mmu.hwio_if};
+            uint64_t cpu_hash = hash64(reinterpret_cast<const uint8_t*>(&cpu->reg), sizeof(cpu->reg));
+            cpu_hash = hash64(mmu.hram.data(), mmu.hram.size(), cpu_hash);
+            cpu_hash = hash64(interrupts, sizeof(interrupts), cpu_hash);
+
+            std::snprintf(line, sizeof(line), "%06llu %016llx %016llx %016llx %016llx\n",
+                static_cast<unsigned long long>(frames_written),
+                static_cast<unsigned long long>(last_hash),
+                static_cast<unsigned long long>(hash64(mmu.iram.data(), mmu.iram.size())),
+                static_cast<unsigned long long>(hash64(mmu.vram.data(), mmu.vram.size())),
+                static_cast<unsigned long long>(cpu_hash));
+        } else {
+            std::snprintf(line, sizeof(line), "%06llu %016llx\n",
+                static_cast<unsigned long long>(frames_written),
+                static_cast<unsigned long long>(last_hash));
+        }
+        file << line;
+    }
+
+    frames_written += 1;
+}
@@ -0,0 +1,332 @@
+/*
+ * headless.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "gpu.hpp"
+#include "mmu.hpp"
+#include "frame_sink.hpp"
+#include "hash_frame_sink.hpp"
+#include "input_script.hpp"
+#include "profiler.hpp"
+#include "breakpoints.hpp"
+#include "recorder_frame_sink.hpp"
+#include "save_state.hpp"
+#include "trace.hpp"
+
+const uint32_t kDefaultFrameCount = 600;
+
+void usage(const char* program) {
+    std::cout << "usage:\n";
+    std::cout << program << " <rom_file> [frame_count] [output.ppm|.raw|.y4m|.png]"
+              << " [--frames n] [--cycles n]"
+              << " [--input script] [--hash hash_file]"
+              << " [--dump-frame ppm_file] [--dump-ram bin_file] [--dump-regs]"
+              << " [--load-state file] [--save-state file]"
+              << " [--trace trace_file] [--trace-mode full|branch|memory]"
+              << " [--break \"<x|r|w> addr[-addr] [if condition]\"]..."
+              << " [--profile folded_file] [--sym sym_file]\n";
+}
+
+void dump_registers(const GBCPU& cpu) {
+    std::cout << std::hex << std::setfill('0')
+              << "a:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.a)
+              << " f:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.f)
+              << " b:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.b)
+              << " c:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.c)
+              << " d:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.d)
+              << " e:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.e)
+              << " h:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.h)
+              << " l:" << std::setw(2) << static_cast<uint16_t>(cpu.reg.l)
+              << " sp:" << std::setw(4) << cpu.reg.sp
+              << " pc:" << std::setw(4) << cpu.reg.pc
+              << std::dec << std::setfill(' ') << "\n";
+}
+
+// Video, cartridge and work RAM, OAM, I/O and high RAM as the CPU sees
+// them, 0x8000-0xffff
+bool dump_ram(const GBMMU& mmu, const std::string& filename) {
+    std::vector<char> ram(0x8000);
+    for (size_t i = 0; i < ram.size(); i++) {
+        ram[i] = static_cast<char>(mmu.peek_byte(static_cast<uint16_t>(0x8000 + i)));
+    }
+
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
+    file.write(ram.data(), ram.size());
+    return static_cast<bool>(file);
+}
+
+// Throughput of the run against real hardware
+void report(uint32_t frames, uint64_t cycles, uint64_t instructions, double seconds) {
+    double emulated = static_cast<double>(cycles) / kTicksPerSecond;
+    std::cout << std::fixed << std::setprecision(2)
+              << frames << " frames, " << cycles << " cycles, " << instructions << " instructions"
+              << " in " << std::setprecision(3) << seconds << " s\n"
+              << std::setprecision(2)
+              << instructions / seconds / 1e6 << " MIPS, "
+              << frames / seconds << " fps, "
+              << emulated / seconds << "x real hardware\n";
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args;
+    std::string input_filename;
+    std::string hash_filename;
+    std::string trace_filename;
+    TraceMode trace_mode = TRACE_FULL;
+    std::vector<std::string> break_specs;
+    std::string profile_filename;
+    std::string sym_filename;
+    std::string frame_dump_filename;
+    std::string ram_dump_filename;
+    std::string load_state_filename;
+    std::string save_state_filename;
+    bool registers_dump = false;
+    uint64_t frame_limit = 0;
+    uint64_t cycle_limit = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--frames" || arg == "--cycles") && i + 1 < argc) {
+            (arg == "--frames" ? frame_limit : cycle_limit) = std::strtoull(argv[++i], nullptr, 10);
+        } else if ((arg == "--dump-frame" || arg == "--dump-ram") && i + 1 < argc) {
+            (arg == "--dump-frame" ? frame_dump_filename : ram_dump_filename) = argv[++i];
+        } else if ((arg == "--load-state" || arg == "--save-state") && i + 1 < argc) {
+            (arg == "--load-state" ? load_state_filename : save_state_filename) = argv[++i];
+        } else if (arg == "--dump-regs") {
+            registers_dump = true;
+        } else if ((arg == "--input" || arg == "--hash") && i + 1 < argc) {
+            (arg == "--input" ? input_filename : hash_filename) = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else if ((arg == "--profile" || arg == "--sym") && i + 1 < argc) {
+            (arg == "--profile" ? profile_filename : sym_filename) = argv[++i];
+        } else if (arg == "--break" && i + 1 < argc) {
+            break_specs.push_back(argv[++i]);
+        } else if (arg == "--trace-mode" && i + 1 < argc) {
+            if (!parse_trace_mode(argv[++i], trace_mode)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg.compare(0, 2, "--") == 0) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty() || args.size() > 3) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    // a cycle limit alone runs until it is reached
+    if (args.size() > 1) {
+        frame_limit = std::strtoull(args[1].c_str(), nullptr, 10);
+    } else if (frame_limit == 0 && cycle_limit == 0) {
+        frame_limit = kDefaultFrameCount;
+    }
+
+    std::unique_ptr<GBCartridge> cartridge(new GBCartridge());
+    cartridge->load(args[0].c_str());
+    if (!cartridge->is_loaded()) {
+        std::cerr << "error: could not load " << args[0] << "\n";
+        return 1;
+    }
+
+    GBInputScript input;
+    if (!input_filename.empty() && !input.load(input_filename)) {
+        return 1;
+    }
+
+    std::unique_ptr<FrameSink> sink;
+    RecordFormat format;
+    if (args.size() > 2 && parse_record_format(args[2], format)) {
+        RecorderFrameSink* recorder = new RecorderFrameSink(args[2], format);
+        sink.reset(recorder);
+        if (!recorder->is_open()) {
+            std::cerr << "error: could not open " << args[2] << "\n";
+            return 1;
+        }
+    } else if (args.size() > 2) {
+        FileFrameSink* file_sink = new FileFrameSink(args[2]);
+        sink.reset(file_sink);
+        if (!file_sink->is_open()) {
+            std::cerr << "error: could not open " << args[2] << "\n";
+            return 1;
+        }
+    } else {
+        sink.reset(new NullFrameSink());
+    }
+
+    GBMMU mmu(cartridge); // ownership of cartridge transfered, don't use!
+    GBCPU cpu(mmu);
+    GBGPU gpu(mmu);
+
+    MemoryFrameSink last_frame(sink.get());
+
+    std::unique_ptr<HashFrameSink> hash_sink;
+    if (!hash_filename.empty()) {
+        hash_sink.reset(new HashFrameSink(hash_filename, &cpu, &last_frame));
+        if (!hash_sink->is_open()) {
+            std::cerr << "error: could not open " << hash_filename << "\n";
+            return 1;
+        }
+        gpu.set_frame_sink(hash_sink.get());
+    } else {
+        gpu.set_frame_sink(&last_frame);
+    }
+
+    std::unique_ptr<GBTraceRecorder> trace;
+    if (!trace_filename.empty()) {
+        trace.reset(new GBTraceRecorder(trace_filename, trace_mode));
+        if (!trace->is_open()) {
+            std::cerr << "error: could not open " << trace_filename << "\n";
+            return 1;
+        }
+        if (trace_mode == TRACE_MEMORY) {
+            mmu.set_memory_observer(trace.get());
+        }
+    }
+
+    GBBreakpoints breakpoints(cpu);
+    for (const auto& spec : break_specs) {
+        std::string error;
+        if (!breakpoints.add(spec, error)) {
+            std::cerr << "error: " << error << "\n";
+            return 1;
+        }
+    }
+
+    GBSymbols symbols;
+    if (!sym_filename.empty() && !symbols.load(sym_filename)) {
+        return 1;
+    }
+
+    std::unique_ptr<GBProfiler> profiler;
+    if (!profile_filename.empty()) {
+        profiler.reset(new GBProfiler(cpu));
+    }
+
+    // skip bios checking
+    cpu.unload_bios();
+
+    if (!load_state_filename.empty()) {
+        std::string error;
+        if (!load_state_file(load_state_filename, cpu, gpu, error)) {
+            std::cerr << "error: " << error << "\n";
+            return 1;
+        }
+    }
+
+    mmu.set_joypad_state(input.state_at(0));
+
+    tick_t clock = 0;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint32_t frames = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        while ((frame_limit == 0 || frames < frame_limit) && (cycle_limit == 0 || cycles < cycle_limit)) {
+            if (breakpoints.check(cpu.reg.pc)) {
+                std::cout << breakpoints.describe(breakpoints.get_hit()) << ", frame " << frames << "\n";
+                break;
+            }
+
+            if (trace) {
+                trace->record_instruction(cpu, cycles);
+            }
+
+            tick_t t = profiler ? profiler->step() : cpu.step();
+            gpu.tick(t);
+            mmu.step(t);
+            clock += t;
+            cycles += t;
+            instructions += 1;
+
+            if (clock >= kTicksPerLcdFrame) {
+                clock -= kTicksPerLcdFrame;
+                if (hash_sink) {
+                    hash_sink->write_frame();
+                }
+                frames += 1;
+                mmu.set_joypad_state(input.state_at(frames));
+            }
+
+            // interrupt handler
+            t = cpu.service_interrupts();
+            if (t) {
+                if (profiler) {
+                    profiler->interrupt(t);
+                }
+                gpu.tick(t);
+                mmu.step(t);
+                clock += t;
+                cycles += t;
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    report(frames, cycles, instructions, elapsed.count());
+
+    if (registers_dump) {
+        dump_registers(cpu);
+    }
+
+    if (!frame_dump_filename.empty()) {
+        FileFrameSink frame_dump(frame_dump_filename);
+        frame_dump.present(last_frame.get_frame().data(), last_frame.get_timestamp());
+        if (!frame_dump.is_open()) {
+            std::cerr << "error: could not write " << frame_dump_filename << "\n";
+            return 1;
+        }
+    }
+
+    if (!ram_dump_filename.empty() && !dump_ram(mmu, ram_dump_filename)) {
+        std::cerr << "error: could not write " << ram_dump_filename << "\n";
+        return 1;
+    }
+
+    if (!save_state_filename.empty() && !save_state_file(save_state_filename, cpu, gpu)) {
+        std::cerr << "error: could not write " << save_state_filename << "\n";
+        return 1;
+    }
+
+    if (profiler) {
+        std::ofstream folded(profile_filename);
+        profiler->write_folded(folded, symbols);
+        if (!folded) {
+            std::cerr << "error: could not write " << profile_filename << "\n";
+            return 1;
+        }
+        profiler->write_report(std::cout, symbols, 20);
+    }
+
+    if (trace) {
+        trace->close();
+        if (trace->get_stalls() > 0) {
+            std::cerr << "trace: " << trace->get_entry_count() << " entries, waited on the writer "
+                      << trace->get_stalls() << " times\n";
+        }
+    }
+
+    return 0;
+}
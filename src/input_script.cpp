@@ -0,0 +1,111 @@
+/*
+ * input_script.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "input_script.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool parse_key(const std::string& name, uint8_t& key) {
+    if (name == "right") {
+        key = JOYPAD_RIGHT;
+    } else if (name == "left") {
+        key = JOYPAD_LEFT;
+    } else if (name == "up") {
+        key = JOYPAD_UP;
+    } else if (name == "down") {
+        key = JOYPAD_DOWN;
+    } else if (name == "a") {
+        key = JOYPAD_A;
+    } else if (name == "b") {
+        key = JOYPAD_B;
+    } else if (name == "select") {
+        key = JOYPAD_SELECT;
+    } else if (name == "start") {
+        key = JOYPAD_START;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+GBInputScript::GBInputScript() : cursor(0) {
+
+}
+
+bool GBInputScript::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "error: could not open " << filename << "\n";
+        return false;
+    }
+
+    std::string error;
+    if (!parse(file, error)) {
+        std::cerr << "error: " << filename << ": " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool GBInputScript::parse(std::istream& input, std::string& error) {
+    changes.clear();
+    cursor = 0;
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(input, line)) {
+        line_number += 1;
+        line = line.substr(0, line.find('#'));
+
+        std::stringstream ss(line);
+        uint64_t frame;
+        std::string keys;
+        if (!(ss >> frame)) {
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            error = "line " + std::to_string(line_number) + ": expected a frame number";
+            return false;
+        }
+
+        if (!(ss >> keys)) {
+            error = "line " + std::to_string(line_number) + ": expected keys";
+            return false;
+        }
+
+        if (!changes.empty() && frame < changes.back().frame) {
+            error = "line " + std::to_string(line_number) + ": frames out of order";
+            return false;
+        }
+
+        uint8_t state = kJoypadReleased;
+        if (keys != "-") {
+            std::stringstream names(keys);
+            std::string name;
+            while (std::getline(names, name, '+')) {
+                uint8_t key;
+                if (!parse_key(name, key)) {
+                    error = "line " + std::to_string(line_number) + ": unknown key " + name;
+                    return false;
+                }
+                state &= ~key;
+            }
+        }
+
+        changes.push_back(Change{frame, state});
+    }
+    return true;
+}
+
+uint8_t GBInputScript::state_at(uint64_t frame) {
+    while (cursor < changes.size() && changes[cursor].frame <= frame) {
+        cursor++;
+    }
+    return cursor > 0 ? changes[cursor - 1].state : kJoypadReleased;
+}
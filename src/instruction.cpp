@@ -7,21 +7,62 @@
 
 #include "instruction.hpp"
 
-std::string Instruction::to_string() {
+#include <cstdio>
+#include <cstring>
+
+std::string Instruction::to_string() const {
+    char prefix[8];
+    sprintf(prefix, "%04hx: ", address);
+    return prefix + to_assembly();
+}
+
+std::string Instruction::to_assembly() const {
     char assembly[32];
     const char* instruction = kInstrunctionNames[opcode];
     const int   length = kInstrunctionLength[opcode];
 
-    sprintf(assembly, "%04hx: ", address);
-    if (length > 1) {
-        sprintf(assembly + 6, instruction, arg0, arg1);
+    if (opcode == 0xcb) {
+        return cb_name(arg0);
+    } else if (length == 3) {
+        // immediates are little endian, printed msb first
+        sprintf(assembly, instruction, arg1, arg0);
+    } else if (length == 2) {
+        sprintf(assembly, instruction, arg0);
     } else {
-        strcpy(assembly  + 6, instruction);
+        strcpy(assembly, instruction);
     }
 
     return std::string(assembly);
 }
 
+std::string Instruction::mnemonic(uint8_t opcode) {
+    static const char* kOperands[][2] = {{"%02x%02x", "nn"}, {"%02x", "n"}, {"%hhd", "e"}};
+
+    std::string name = kInstrunctionNames[opcode];
+    for (const auto& operand : kOperands) {
+        size_t at = name.find(operand[0]);
+        if (at != std::string::npos) {
+            name.replace(at, std::strlen(operand[0]), operand[1]);
+        }
+    }
+    return name;
+}
+
+std::string Instruction::cb_name(uint8_t opcode) {
+    static const char* kOperands[8]   = {"b", "c", "d", "e", "h", "l", "(hl)", "a"};
+    static const char* kRotations[8]  = {"rlc", "rrc", "rl", "rr", "sla", "sra", "swap", "srl"};
+    static const char* kBitOps[4]     = {"", "bit", "res", "set"};
+
+    char name[16];
+    const char* operand = kOperands[opcode & 0x07];
+    if (opcode < 0x40) {
+        sprintf(name, "%s %s", kRotations[opcode >> 3], operand);
+    } else {
+        sprintf(name, "%s %d,%s", kBitOps[opcode >> 6], (opcode >> 3) & 0x07, operand);
+    }
+    return std::string(name);
+}
+
 const uint8_t Instruction::kInstrunctionLength[256] = {
     1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,    // 0x00 ~ 0x0F
     2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,    // 0x10 ~ 0x1F
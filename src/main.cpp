@@ -4,10 +4,12 @@
 #include <SDL_ttf.h>
 
 void dump_cpu(const GBCPU&);
-void unload_bios(GBCPU& cpu, GBMMU& mmu);
-void process_events(bool& running, GBJoypad& joypad);
+void process_events(bool& running, GBJoypad& joypad, FramePacer& pacer, SpeedControl& speed);
+void wait_for_resume(bool& running, GBJoypad& joypad, SdlFrameSink& display, SDL_Keycode key);
+std::string speed_title(const std::string& title, const SpeedControl& speed, const FramePacer& pacer);
 
-void emulator(const char* filename) {
+void emulator(const char* filename, const char* scale, PacingMode pacing, SpeedControl& speed,
+        const std::vector<std::string>& break_specs) {
     std::unique_ptr<GBCartridge> cartridge(new GBCartridge());
     cartridge->load(filename);
     if (!cartridge->is_loaded()) {
@@ -21,75 +23,101 @@ void emulator(const char* filename) {
     GBGPU gpu(mmu);
     GBJoypad joypad;
 
+    SdlFrameSink display;
+    gpu.set_frame_sink(&display);
+
+    ScaleFilter filter = SCALE_NEAREST;
+    int factor = 1;
+    if (scale && !parse_scale_filter(scale, filter, factor)) {
+        std::cerr << "unknown scale filter: " << scale << "\n";
+        return;
+    }
+    if (factor > 1) {
+        display.set_scaler(filter, factor, std::max(1u, std::thread::hardware_concurrency() / 2));
+    }
+
     Debugger debugger(cpu, gpu, joypad);
 
-    gpu.set_window_title(game_title);
+    GBBreakpoints breakpoints(cpu);
+    for (const auto& spec : break_specs) {
+        std::string error;
+        if (!breakpoints.add(spec, error)) {
+            std::cerr << "breakpoint " << error << "\n";
+            return;
+        }
+    }
+
+    FramePacer pacer(pacing);
+    if (pacing == PACE_VSYNC) {
+        display.set_vsync(&pacer);
+    }
+    pacer.set_speed(speed.get_speed());
+
+    std::string window_title = speed_title(game_title, speed, pacer);
+    display.set_window_title(window_title);
 
     bool running = true;
 
     // skip bios checking
-    unload_bios(cpu, mmu);
+    cpu.unload_bios();
 
     debugger.show();
-    gpu.show();
+    display.show();
     try {
         tick_t clock = 0;
         while(running) {
-            debugger.log_instruction();
-
-            // fetch
-            uint8_t op = cpu.mmu.read_byte(cpu.reg.pc++);
+            if (breakpoints.check(cpu.reg.pc)) {
+                std::cerr << breakpoints.describe(breakpoints.get_hit()) << ", F5 to continue\n";
+                debugger.publish_snapshot();
+                wait_for_resume(running, joypad, display, SDLK_F5);
+                breakpoints.resume();
+                pacer.resume();
+                continue;
+            }
 
-            // decode
-            auto& instruction = cpu.instruction_map.at(op);
+            debugger.log_instruction();
 
-            // execute
-            tick_t t = (cpu.*instruction)();
+            tick_t t = cpu.step();
             //dump_cpu(cpu);
 
-            gpu.step(t);
+            gpu.tick(t);
             mmu.step(t);
             clock += t;
 
             // sync
-            if (clock >= kTicksPerFrame) {
-                clock -= kTicksPerFrame;
+            if (clock >= kTicksPerLcdFrame) {
+                clock -= kTicksPerLcdFrame;
+
+                process_events(running, joypad, pacer, speed);
 
-                process_events(running, joypad);
+                if (pacer.is_paused()) {
+                    std::cerr << "paused, P to continue\n";
+                    debugger.publish_snapshot();
+                    wait_for_resume(running, joypad, display, SDLK_p);
+                    pacer.resume();
+                }
                 mmu.set_joypad_state(joypad.get_pressed_keys());
 
-                debugger.draw();
+                debugger.publish_snapshot();
+
+                if (speed.get_speed() != pacer.get_speed()) {
+                    pacer.set_speed(speed.get_speed());
+                }
+                gpu.set_frame_skip(speed.get_frame_skip(pacer.get_measured_speed()));
 
-                SDL_Delay(kMillisPerFrame);
+                std::string title = speed_title(game_title, speed, pacer);
+                if (title != window_title) {
+                    window_title = title;
+                    display.set_window_title(window_title);
+                }
+
+                pacer.wait_frame();
             }
 
             // interrupt handler
-            if (mmu.interrupt_master_enabled && (mmu.hwio_ie & mmu.hwio_if)) {
-                mmu.disable_interrupts();
-
-                t = 0;
-                if (mmu.hwio_if & kInterruptionVBlank) {
-                    mmu.hwio_if &= ~kInterruptionVBlank;
-                    t += cpu.rst_40();
-                    //std::cout << "catch vblank interruption\n";
-                } else if (mmu.hwio_if & kInterruptionLcdStat) {
-                    mmu.hwio_if &= ~kInterruptionLcdStat;
-                    t += cpu.rst_48();
-                    //std::cout << "catch lcdc stat interruption\n";
-                } else if (mmu.hwio_if & kInterruptionTimer) {
-                    mmu.hwio_if &= ~kInterruptionTimer;
-                    t += cpu.rst_50();
-                    //std::cout << "catch serial interruption\n";
-                } else if (mmu.hwio_if & kInterruptionSerial) {
-                    mmu.hwio_if &= ~kInterruptionSerial;
-                    t += cpu.rst_58();
-                    //std::cout << "catch serial interruption\n";
-                } else if (mmu.hwio_if & kInterruptionJoypad) {
-                    mmu.hwio_if &= ~kInterruptionJoypad;
-                    t += cpu.rst_60();
-                    //std::cout << "catch joypad interruption\n";
-                }
-                gpu.step(t);
+            t = cpu.service_interrupts();
+            if (t) {
+                gpu.tick(t);
                 mmu.step(t);
                 clock += t;
             }
@@ -98,19 +126,51 @@ void emulator(const char* filename) {
     } catch (std::exception& e) {
         std::cerr << "error: " << e.what() << "\n";
     }
-    gpu.hide();
+    display.hide();
     debugger.hide();
 }
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
+    std::vector<std::string> args;
+    std::vector<std::string> break_specs;
+    PacingMode pacing = PACE_REALTIME;
+    SpeedControl speed;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--break" && i + 1 < argc) {
+            break_specs.push_back(argv[++i]);
+        } else if (arg == "--pace" && i + 1 < argc) {
+            if (!parse_pacing_mode(argv[++i], pacing)) {
+                std::cerr << "unknown pacing mode: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if ((arg == "--speed" || arg == "--turbo") && i + 1 < argc) {
+            double value = 1;
+            if (!parse_speed(argv[++i], value)) {
+                std::cerr << "invalid speed: " << argv[i] << "\n";
+                return 1;
+            }
+            if (arg == "--speed") {
+                speed.set_speed(value);
+            } else {
+                speed.set_turbo_speed(value);
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() != 1 && args.size() != 2) {
         std::cout << "usage:\n";
-        std::cout << argv[0] << " <rom_file>\n";
+        std::cout << argv[0] << " <rom_file> [1x..8x|scale2x|scale3x]"
+                  << " [--pace realtime|vsync|uncapped]"
+                  << " [--speed <n>x|unlimited] [--turbo <n>x|unlimited]"
+                  << " [--break \"<x|r|w> addr[-addr] [if condition]\"]...\n";
         return 0;
     }
 
     if (SDL_Init(SDL_INIT_VIDEO) >= 0 && TTF_Init() == 0) {
-        emulator(argv[1]);
+        emulator(args[0].c_str(), args.size() == 2 ? args[1].c_str() : nullptr, pacing, speed, break_specs);
         TTF_Quit();
         SDL_Quit();
     } else {
@@ -139,57 +199,9 @@ void dump_cpu(const GBCPU& cpu) {
     std::cout << std::dec << "\n\n";
 }
 
-void unload_bios(GBCPU& cpu, GBMMU& mmu) {
-    cpu.reg.af = 0x00b0;
-    cpu.reg.bc = 0x0013;
-    cpu.reg.de = 0x00d8;
-    cpu.reg.hl = 0x014d;
-    cpu.reg.sp = 0xfffe;
-    cpu.reg.pc = 0x0100;
-
-    mmu.bios_loaded = false;
-
-    mmu.hwio_tima = 0x00;
-    mmu.hwio_tma  = 0x00;
-    mmu.hwio_tac  = 0x00;
-
-    mmu.hwio_nr10 = 0x80;
-    mmu.hwio_nr11 = 0xbf;
-    mmu.hwio_nr12 = 0xf3;
-    mmu.hwio_nr14 = 0xbf;
-
-    mmu.hwio_nr21 = 0x3f;
-    mmu.hwio_nr22 = 0x00;
-    mmu.hwio_nr24 = 0xbf;
-
-    mmu.hwio_nr30 = 0x7f;
-    mmu.hwio_nr31 = 0xff;
-    mmu.hwio_nr32 = 0x9f;
-    mmu.hwio_nr33 = 0xbf;
-
-    mmu.hwio_nr41 = 0xff;
-    mmu.hwio_nr42 = 0x00;
-    mmu.hwio_nr43 = 0x00;
-    mmu.hwio_nr44 = 0xbf;
-
-    mmu.hwio_nr50 = 0x77;
-    mmu.hwio_nr51 = 0xf3;
-    mmu.hwio_nr52 = 0xf1;
-
-    mmu.hwio_lcdc = 0x91;
-    mmu.hwio_stat = 0x02;
-    mmu.hwio_scy  = 0x00;
-    mmu.hwio_scx  = 0x00;
-    mmu.hwio_lyc  = 0x00;
-    mmu.hwio_bgp  = 0xfc;
-    mmu.hwio_obp0 = 0xff;
-    mmu.hwio_obp1 = 0xff;
-    mmu.hwio_wx   = 0x00;
-    mmu.hwio_wy   = 0x00;
-    mmu.hwio_ie   = 0x00;
-}
-
-void process_events(bool& running, GBJoypad& joypad) {
+// Tab fast-forwards while held, T toggles turbo, - and = step the speed
+// down and up, backspace goes back to 1x
+void process_events(bool& running, GBJoypad& joypad, FramePacer& pacer, SpeedControl& speed) {
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
@@ -198,6 +210,57 @@ void process_events(bool& running, GBJoypad& joypad) {
             running = false;
         } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE) {
             running = false;
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p) {
+            pacer.pause();
+        } else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.keysym.sym == SDLK_TAB) {
+            speed.hold_turbo(event.type == SDL_KEYDOWN);
+        } else if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+            switch (event.key.keysym.sym) {
+                case SDLK_t:
+                    speed.toggle_turbo();
+                    break;
+                case SDLK_EQUALS:
+                    speed.faster();
+                    break;
+                case SDLK_MINUS:
+                    speed.slower();
+                    break;
+                case SDLK_BACKSPACE:
+                    speed.set_speed(1);
+                    break;
+            }
+        }
+    }
+}
+
+std::string speed_title(const std::string& title, const SpeedControl& speed, const FramePacer& pacer) {
+    std::ostringstream out;
+    out << title << " - " << (speed.is_turbo() ? "turbo " : "") << format_speed(speed.get_speed());
+    if (pacer.get_measured_speed() > 0) {
+        out.precision(3);
+        out << " (" << pacer.get_measured_speed() << "x)";
+    }
+    return out.str();
+}
+
+// Stopped at a breakpoint or paused, blocks on window events until key.
+// The display stops presenting too, so nothing uses the CPU meanwhile.
+void wait_for_resume(bool& running, GBJoypad& joypad, SdlFrameSink& display, SDL_Keycode key) {
+    display.pause();
+
+    SDL_Event event;
+    while (running && SDL_WaitEvent(&event)) {
+        joypad.process_events(event);
+        if (event.type == SDL_QUIT || (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+            running = false;
+        } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE) {
+            running = false;
+        } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+            display.redraw();
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == key) {
+            break;
         }
     }
+
+    display.resume();
 }
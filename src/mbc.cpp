@@ -6,15 +6,56 @@ const uint32_t kRAMBankSize = 0x2000;
 const uint32_t kROMBankSize = 0x4000;
 
 MBC::MBC(uint32_t rom_bank_count, uint32_t ram_bank_count) :
-    rom_bank_count(rom_bank_count), ram_bank_count(ram_bank_count), rom_bank_number(1), ram_bank_number(0) {
+    rom_bank_count(rom_bank_count), ram_bank_count(ram_bank_count), rom_bank_number(1), ram_bank_number(0),
+    ram_enabled(false) {
 
 }
 
+void MBC::save_state(GBStateWriter& writer) const {
+    writer.write(rom_bank_number);
+    writer.write(ram_bank_number);
+    writer.write(ram_enabled);
+}
+
+void MBC::read_state(GBStateReader& reader) {
+    reader.read(rom_bank_number);
+    reader.read(ram_bank_number);
+    reader.read(ram_enabled);
+}
+
+bool MBC::banks_in_range() const {
+    return (!rom_bank_count || rom_bank_number < rom_bank_count) &&
+           (!ram_bank_count || ram_bank_number < ram_bank_count);
+}
+
+void MBC::load_state(GBStateReader& reader) {
+    read_state(reader);
+    if (reader.is_ok() && !banks_in_range()) {
+        reader.fail("save state bank number out of range");
+    }
+}
+
 MBC1::MBC1(uint32_t rom_bank_count, uint32_t ram_bank_count) : MBC(rom_bank_count, ram_bank_count),
     is_ram_banking_mode(false) {
 
 }
 
+void MBC1::save_state(GBStateWriter& writer) const {
+    MBC::save_state(writer);
+    writer.write(is_ram_banking_mode);
+}
+
+void MBC1::read_state(GBStateReader& reader) {
+    MBC::read_state(reader);
+    reader.read(is_ram_banking_mode);
+}
+
+// In rom banking mode the ram bank register holds the upper rom bank bits
+bool MBC1::banks_in_range() const {
+    return (!rom_bank_count || get_rom_bank() < rom_bank_count) &&
+           (!is_ram_banking_mode || !ram_bank_count || ram_bank_number < ram_bank_count);
+}
+
 MBC2::MBC2(uint32_t rom_bank_count, uint32_t ram_bank_count) : MBC(rom_bank_count, ram_bank_count) {
 
 }
@@ -53,12 +94,7 @@ uint32_t MBC1::translate_address(uint16_t addr) {
         return addr;
     } else if (addr <= 0x7fff) {
         // Switchable ROM Bank
-        uint32_t bank = rom_bank_number;
-        if (!is_ram_banking_mode) {
-            bank += ram_bank_number << 5;
-        }
-
-        uint32_t translate_address = addr + (bank - 1) * kROMBankSize;
+        uint32_t translate_address = addr + (get_rom_bank() - 1) * kROMBankSize;
         return translate_address;
     } else if (addr >= 0xa000 && addr <= 0xbfff) {
         // Switchable RAM Bank
@@ -72,6 +108,14 @@ uint32_t MBC1::translate_address(uint16_t addr) {
     }
 }
 
+uint32_t MBC1::get_rom_bank() const {
+    uint32_t bank = rom_bank_number;
+    if (!is_ram_banking_mode) {
+        bank += ram_bank_number << 5;
+    }
+    return bank;
+}
+
 void MBC1::write(uint16_t addr, uint8_t value) {
     if (addr <= 0x1fff) {
         ram_enabled = ((value & 0x0f) == 0x0a) ? true : false;
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <iomanip>
 #include <cassert>
+#include <cstring>
 
 // Base Addresses
 const uint16_t kAddrInterruptFlag     = 0xffff;
@@ -57,18 +58,6 @@ const uint16_t kAddrNR50 = 0xff24;
 const uint16_t kAddrNR51 = 0xff25;
 const uint16_t kAddrNR52 = 0xff26;
 const uint16_t kAddrWave = 0xff30;
-const uint16_t kAddrLCDC = 0xff40;
-const uint16_t kAddrSTAT = 0xff41;
-const uint16_t kAddrSCY  = 0xff42;
-const uint16_t kAddrSCX  = 0xff43;
-const uint16_t kAddrLY   = 0xff44;
-const uint16_t kAddrLYC  = 0xff45;
-const uint16_t kAddrDMA  = 0xff46;
-const uint16_t kAddrBGP  = 0xff47;
-const uint16_t kAddrOBP0 = 0xff48;
-const uint16_t kAddrOBP1 = 0xff49;
-const uint16_t kAddrWY   = 0xff4a;
-const uint16_t kAddrWX   = 0xff4b;
 
 const uint16_t kAddrUnloadBIOS = 0xff50;
 
@@ -92,6 +81,9 @@ void dump_mmu_oper(const char * op, uint16_t offset, uint16_t value);
 
 GBMMU::GBMMU() :
     tick_counter(0),
+    video_observer(nullptr),
+    memory_observer(nullptr),
+    rom_bank(1),
     vram(kSizeVRAM, 0),
     oram(kSizeORAM, 0),
     hram(kSizeHRAM, 0),
@@ -99,6 +91,8 @@ GBMMU::GBMMU() :
     bios_loaded(true),
     interrupt_master_enabled(false) {
 
+    observed_pages.fill(true);
+
     hwio_p1 = 0;
     hwio_sb = 0;
     hwio_sc = 0;
@@ -162,7 +156,147 @@ inline uint8_t read(uint16_t addr, uint16_t base, const std::vector<uint8_t>& me
     return memory.at(addr - base);
 }
 
+void GBMMU::save_state(GBStateWriter& writer) const {
+    writer.write_tag("MMU ");
+    writer.write(tick_counter);
+    writer.write(bios_loaded);
+    writer.write(interrupt_master_enabled);
+    writer.write(joypad_state);
+
+    writer.write_vector(vram);
+    writer.write_vector(oram);
+    writer.write_vector(hram);
+    writer.write_vector(iram);
+
+    writer.write(hwio_p1);
+    writer.write(hwio_sb);
+    writer.write(hwio_sc);
+    writer.write(hwio_div);
+    writer.write(hwio_tima);
+    writer.write(hwio_tma);
+    writer.write(hwio_tac);
+    writer.write(hwio_if);
+    writer.write(hwio_nr10);
+    writer.write(hwio_nr11);
+    writer.write(hwio_nr12);
+    writer.write(hwio_nr13);
+    writer.write(hwio_nr14);
+    writer.write(hwio_nr20);
+    writer.write(hwio_nr21);
+    writer.write(hwio_nr22);
+    writer.write(hwio_nr23);
+    writer.write(hwio_nr24);
+    writer.write(hwio_nr30);
+    writer.write(hwio_nr31);
+    writer.write(hwio_nr32);
+    writer.write(hwio_nr33);
+    writer.write(hwio_nr34);
+    writer.write(hwio_nr40);
+    writer.write(hwio_nr41);
+    writer.write(hwio_nr42);
+    writer.write(hwio_nr43);
+    writer.write(hwio_nr44);
+    writer.write(hwio_nr50);
+    writer.write(hwio_nr51);
+    writer.write(hwio_nr52);
+    writer.write(hwio_wave);
+    writer.write(hwio_lcdc);
+    writer.write(hwio_stat);
+    writer.write(hwio_scy);
+    writer.write(hwio_scx);
+    writer.write(hwio_ly);
+    writer.write(hwio_lyc);
+    writer.write(hwio_dma);
+    writer.write(hwio_bgp);
+    writer.write(hwio_obp0);
+    writer.write(hwio_obp1);
+    writer.write(hwio_wy);
+    writer.write(hwio_wx);
+    writer.write(hwio_ie);
+
+    writer.write(static_cast<bool>(cartridge));
+    if (cartridge) {
+        cartridge->save_state(writer);
+    }
+}
+
+void GBMMU::load_state(GBStateReader& reader) {
+    reader.read_tag("MMU ");
+    reader.read(tick_counter);
+    reader.read(bios_loaded);
+    reader.read(interrupt_master_enabled);
+    reader.read(joypad_state);
+
+    reader.read_vector(vram);
+    reader.read_vector(oram);
+    reader.read_vector(hram);
+    reader.read_vector(iram);
+
+    reader.read(hwio_p1);
+    reader.read(hwio_sb);
+    reader.read(hwio_sc);
+    reader.read(hwio_div);
+    reader.read(hwio_tima);
+    reader.read(hwio_tma);
+    reader.read(hwio_tac);
+    reader.read(hwio_if);
+    reader.read(hwio_nr10);
+    reader.read(hwio_nr11);
+    reader.read(hwio_nr12);
+    reader.read(hwio_nr13);
+    reader.read(hwio_nr14);
+    reader.read(hwio_nr20);
+    reader.read(hwio_nr21);
+    reader.read(hwio_nr22);
+    reader.read(hwio_nr23);
+    reader.read(hwio_nr24);
+    reader.read(hwio_nr30);
+    reader.read(hwio_nr31);
+    reader.read(hwio_nr32);
+    reader.read(hwio_nr33);
+    reader.read(hwio_nr34);
+    reader.read(hwio_nr40);
+    reader.read(hwio_nr41);
+    reader.read(hwio_nr42);
+    reader.read(hwio_nr43);
+    reader.read(hwio_nr44);
+    reader.read(hwio_nr50);
+    reader.read(hwio_nr51);
+    reader.read(hwio_nr52);
+    reader.read(hwio_wave);
+    reader.read(hwio_lcdc);
+    reader.read(hwio_stat);
+    reader.read(hwio_scy);
+    reader.read(hwio_scx);
+    reader.read(hwio_ly);
+    reader.read(hwio_lyc);
+    reader.read(hwio_dma);
+    reader.read(hwio_bgp);
+    reader.read(hwio_obp0);
+    reader.read(hwio_obp1);
+    reader.read(hwio_wy);
+    reader.read(hwio_wx);
+    reader.read(hwio_ie);
+
+    bool has_cartridge = false;
+    if (reader.read(has_cartridge) && has_cartridge != static_cast<bool>(cartridge)) {
+        reader.fail("save state cartridge presence differs");
+    }
+    if (cartridge && reader.is_ok()) {
+        cartridge->load_state(reader);
+        rom_bank = cartridge->get_rom_bank();
+    }
+}
+
 uint8_t GBMMU::read_byte(uint16_t addr) const {
+    uint8_t value = load_byte(addr);
+    if (memory_observer && observed_pages[addr >> 8]) {
+        memory_observer->memory_read(addr, value);
+    }
+    return value;
+}
+
+uint8_t GBMMU::load_byte(uint16_t addr) const {
     if (bios_loaded && addr < kGameBoyBiosLength) {
         return kGameBoyBios[addr];
     }
@@ -199,6 +333,13 @@ uint8_t GBMMU::read_byte(uint16_t addr) const {
     }
 }
 
+uint8_t GBMMU::read_rom_bank(uint32_t bank, uint16_t addr) const {
+    if (bios_loaded && addr < kGameBoyBiosLength) {
+        return kGameBoyBios[addr];
+    }
+    return cartridge->read_rom_bank(bank, addr);
+}
+
 uint16_t GBMMU::read_word(uint16_t addr) const {
     uint8_t lsb = read_byte(addr);
     uint8_t msb = read_byte(addr + 1);
@@ -212,8 +353,13 @@ inline void write(uint8_t value, uint16_t addr, uint16_t base,
 }
 
 void GBMMU::write_byte(uint16_t addr, uint8_t value) {
+    if (memory_observer && observed_pages[addr >> 8]) {
+        memory_observer->memory_write(addr, value);
+    }
+
     if (addr < 0x8000) {
         cartridge->write(addr, value);
+        rom_bank = cartridge->get_rom_bank();
         //dump_mmu_oper("w cart", addr, value);
         return;
     }
@@ -226,6 +372,9 @@ void GBMMU::write_byte(uint16_t addr, uint8_t value) {
 
     for (int i = 0; i < len; i++) {
         if (addr >= mem_addr[i] && addr < (mem_addr[i] + mem_size[i])) {
+            if (video_observer && (mem[i] == &vram || mem[i] == &oram)) {
+                video_observer->video_memory_write(addr, value);
+            }
             write(value, addr, mem_addr[i], *mem[i]);
             //dump_mmu_oper(mem_name[i], addr, value);
             return;
@@ -304,23 +453,29 @@ void GBMMU::set_joypad_state(uint8_t state) {
 }
 
 void GBMMU::update_p1() {
+    // select lines and keys are active low, P14 selects the directions
+    // (low nibble of joypad_state) and P15 the buttons (high nibble)
     switch ((hwio_p1 >> 4) & 0x3) {
         case 0:
-            hwio_p1 = (hwio_p1 & 0xf0);
+            hwio_p1 = (hwio_p1 & 0xf0) | ((joypad_state & 0x0f) & (joypad_state >> 4));
             break;
         case 1:
-            hwio_p1 = (hwio_p1 & 0xf0) | (joypad_state & 0x0f);
+            hwio_p1 = (hwio_p1 & 0xf0) | (joypad_state >> 4);
             break;
         case 2:
-            hwio_p1 = (hwio_p1 & 0xf0) | (joypad_state >> 4);
+            hwio_p1 = (hwio_p1 & 0xf0) | (joypad_state & 0x0f);
             break;
         case 3:
-            hwio_p1 = (hwio_p1 & 0xf0) | ((joypad_state & 0x0f) | (joypad_state >> 4));
+            hwio_p1 = (hwio_p1 & 0xf0) | 0x0f;
             break;
     }
 }
 
 uint8_t GBMMU::read_hwio(uint16_t addr) const {
+    if (video_observer && (addr == kAddrLY || addr == kAddrSTAT)) {
+        video_observer->lcd_register_read(addr);
+    }
+
     switch (addr) {
         case kAddrP1:
             return hwio_p1;
@@ -428,6 +583,10 @@ uint8_t GBMMU::read_hwio(uint16_t addr) const {
 }
 
 void GBMMU::write_hwio(uint16_t addr,  uint8_t value) {
+    if (video_observer && addr >= kAddrLCDC && addr <= kAddrWX) {
+        video_observer->lcd_register_write(addr, value);
+    }
+
     switch (addr) {
         case kAddrP1:
             hwio_p1 = (hwio_p1 & 0x0f) | (value & 0x30);
@@ -559,10 +718,11 @@ void GBMMU::write_hwio(uint16_t addr,  uint8_t value) {
         case kAddrDMA: {
             uint16_t src_addr = value << 8;
             const uint16_t kSizeDMABlock = 0xa0;
+            std::vector<uint8_t> block(kSizeDMABlock, 0);
             if (src_addr < (kAddrCROM + kSizeCROM - kSizeDMABlock)) {
                 // from cartridge
                 // std::cout << "dma copy from rom " << std::hex << (uint16_t) src_addr << "\n";
-                cartridge->dma_read(src_addr, kSizeDMABlock, oram.begin());
+                cartridge->dma_read(src_addr, kSizeDMABlock, block.begin());
             } else if (src_addr >= kAddrIRAM && src_addr < (kAddrIRAM + kSizeIRAM - kSizeDMABlock)) {
                 // from IRAM
                 // std::cout << "dma copy from ram " << std::hex << (uint16_t) src_addr << "\n";
@@ -570,7 +730,7 @@ void GBMMU::write_hwio(uint16_t addr,  uint8_t value) {
                 std::copy(
                     iram.begin() + src_addr,
                     iram.begin() + src_addr + kSizeDMABlock,
-                    oram.begin());
+                    block.begin());
             } else if (src_addr >= kAddrHRAM && src_addr < (kAddrHRAM + kSizeHRAM - kSizeDMABlock)) {
                 // from HRAM
                 //std::cout << "dma copy from hram " << std::hex << (uint16_t) src_addr << "\n";
@@ -578,10 +738,18 @@ void GBMMU::write_hwio(uint16_t addr,  uint8_t value) {
                 std::copy(
                     hram.begin() + src_addr,
                     hram.begin() + src_addr + kSizeDMABlock,
-                    oram.begin());
+                    block.begin());
             } else {
                 std::cerr << "dma error " << std::hex << (uint16_t) src_addr << "\n";
+                break;
             }
+
+            if (video_observer) {
+                for (uint16_t i = 0; i < kSizeDMABlock; i++) {
+                    video_observer->video_memory_write(kAddrORAM + i, block[i]);
+                }
+            }
+            std::copy(block.begin(), block.end(), oram.begin());
             // std::cout << print_bytes(oram.begin(), oram.begin() + kSizeDMABlock).str().c_str();
             // std::cout << "\n";
             break;
@@ -619,6 +787,19 @@ void GBMMU::check_lcdc_line_coincidence() {
     }
 }
 
+void GBMMU::set_video_observer(GBVideoObserver* observer) {
+    video_observer = observer;
+}
+
+void GBMMU::set_memory_observer(GBMemoryObserver* observer) {
+    memory_observer = observer;
+    observed_pages.fill(true);
+}
+
+void GBMMU::observe_page(uint8_t page, bool observed) {
+    observed_pages[page] = observed;
+}
+
 uint8_t* GBMMU::get_oam_ram_head() {
     return oram.data();
 }
@@ -0,0 +1,89 @@
+/*
+ * opcode_profile.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "opcode_profile.hpp"
+
+#ifdef GB_OPCODE_PROFILE
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "instruction.hpp"
+
+OpcodeProfile::OpcodeProfile() {
+    clear();
+}
+
+OpcodeProfile::~OpcodeProfile() {
+    write_report(std::cerr);
+}
+
+OpcodeProfile& OpcodeProfile::global() {
+    static OpcodeProfile profile;
+    return profile;
+}
+
+void OpcodeProfile::clear() {
+    std::memset(base, 0, sizeof(base));
+    std::memset(cb, 0, sizeof(cb));
+}
+
+void OpcodeProfile::write_report(std::ostream& out) const {
+    struct Row {
+        bool prefixed;
+        uint8_t opcode;
+        const Counter* counter;
+    };
+
+    std::vector<Row> rows;
+    uint64_t executed = 0;
+    uint64_t host_total = 0;
+    for (int i = 0; i < 256; i++) {
+        if (base[i].count) {
+            rows.push_back(Row{false, static_cast<uint8_t>(i), &base[i]});
+            executed += base[i].count;
+            // cb time is counted again in its own rows
+            host_total += (i == 0xcb) ? 0 : base[i].host_cycles;
+        }
+        if (cb[i].count) {
+            rows.push_back(Row{true, static_cast<uint8_t>(i), &cb[i]});
+            host_total += cb[i].host_cycles;
+        }
+    }
+    if (rows.empty()) {
+        return;
+    }
+
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+        return a.counter->host_cycles > b.counter->host_cycles;
+    });
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "opcode profile, %llu instructions, %llu host cycles\n",
+        static_cast<unsigned long long>(executed), static_cast<unsigned long long>(host_total));
+    out << line;
+    out << "opcode  instruction          executed   mix%   host%  cycles/exec  ticks/exec\n";
+
+    for (const Row& row : rows) {
+        const Counter& counter = *row.counter;
+        std::string name = row.prefixed ? Instruction::cb_name(row.opcode)
+                                        : Instruction::mnemonic(row.opcode);
+        std::snprintf(line, sizeof(line), "%s%02x  %-18s %12llu %6.2f %7.2f %12.1f %11.1f\n",
+            row.prefixed ? "cb" : "  ", row.opcode, name.c_str(),
+            static_cast<unsigned long long>(counter.count),
+            100.0 * counter.count / executed,
+            100.0 * counter.host_cycles / std::max<uint64_t>(host_total, 1),
+            static_cast<double>(counter.host_cycles) / counter.count,
+            static_cast<double>(counter.ticks) / counter.count);
+        out << line;
+    }
+}
+
+#endif
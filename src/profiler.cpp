@@ -0,0 +1,147 @@
+/*
+ * profiler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+
+const size_t kMaxProfileDepth = 256;
+const uint32_t kRootFunction = 0xffffffff;
+
+GBProfiler::GBProfiler(GBCPU& cpu) :
+    cpu(cpu), mmu(cpu.mmu), histogram(0x10000, 0), total_cycles(0),
+    nodes(), children(), stack(), current(0), lost_frames(0) {
+
+    nodes.push_back(Node{0, kRootFunction, 0});
+}
+
+void GBProfiler::enter(uint16_t addr, uint16_t sp) {
+    if (stack.size() == kMaxProfileDepth) {
+        lost_frames++;
+        return;
+    }
+
+    uint32_t function = function_key(mmu.get_rom_bank(), addr);
+    uint64_t edge = (static_cast<uint64_t>(current) << 32) | function;
+    auto it = children.find(edge);
+    if (it == children.end()) {
+        it = children.insert(std::make_pair(edge, static_cast<uint32_t>(nodes.size()))).first;
+        nodes.push_back(Node{current, function, 0});
+    }
+
+    current = it->second;
+    stack.push_back(Frame{current, sp});
+}
+
+void GBProfiler::leave(uint16_t sp) {
+    // frames left without a ret, by code that drops its return address,
+    // are closed together with the one that returns
+    while (!stack.empty() && stack.back().sp <= sp) {
+        stack.pop_back();
+    }
+    current = stack.empty() ? 0 : stack.back().node;
+}
+
+uint64_t GBProfiler::get_cycles(uint32_t bank, uint16_t pc) const {
+    size_t index = pc;
+    if (bank >= 2 && pc >= 0x4000 && pc < 0x8000) {
+        index = 0x10000 + (bank - 2) * 0x4000 + (pc - 0x4000);
+    }
+    return (index < histogram.size()) ? histogram[index] : 0;
+}
+
+std::string GBProfiler::function_name(uint32_t function, const GBSymbols& symbols) const {
+    if (function == kRootFunction) {
+        return "root";
+    }
+    return symbols.describe(function >> 16, function & 0xffff);
+}
+
+void GBProfiler::write_folded(std::ostream& out, const GBSymbols& symbols) const {
+    std::vector<std::string> names(nodes.size());
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        // parents always come before their children
+        names[i] = (i == 0) ? function_name(nodes[i].function, symbols)
+            : names[nodes[i].parent] + ";" + function_name(nodes[i].function, symbols);
+        if (nodes[i].cycles > 0) {
+            lines.push_back(names[i] + " " + std::to_string(nodes[i].cycles));
+        }
+    }
+
+    std::sort(lines.begin(), lines.end());
+    for (const auto& line : lines) {
+        out << line << "\n";
+    }
+}
+
+void GBProfiler::write_report(std::ostream& out, const GBSymbols& symbols, size_t top) const {
+    char line[160];
+    double total = std::max<uint64_t>(total_cycles, 1);
+
+    std::snprintf(line, sizeof(line), "%llu cycles profiled, %zu call stacks\n",
+        static_cast<unsigned long long>(total_cycles), nodes.size());
+    out << line;
+
+    std::vector<std::pair<uint64_t, size_t>> hottest;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        if (histogram[i] > 0) {
+            hottest.push_back(std::make_pair(histogram[i], i));
+        }
+    }
+    std::sort(hottest.begin(), hottest.end(), std::greater<std::pair<uint64_t, size_t>>());
+
+    out << "\nhottest addresses:\n";
+    for (size_t i = 0; i < std::min(top, hottest.size()); i++) {
+        size_t index = hottest[i].second;
+        uint32_t bank = (index < 0x10000) ? (index >= 0x4000 && index < 0x8000) : 2 + (index - 0x10000) / 0x4000;
+        uint16_t pc = (index < 0x10000) ? index : 0x4000 + (index - 0x10000) % 0x4000;
+        std::snprintf(line, sizeof(line), "%12llu %6.2f%%  %02x:%04x %s\n",
+            static_cast<unsigned long long>(hottest[i].first), 100.0 * hottest[i].first / total,
+            (pc >= 0x4000 && pc < 0x8000) ? bank : 0, pc,
+            symbols.size() > 0 ? symbols.describe(bank, pc).c_str() : "");
+        out << line;
+    }
+
+    // self cycles, and inclusive ones counting each function once per stack
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> functions;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].cycles == 0) {
+            continue;
+        }
+        functions[nodes[i].function].first += nodes[i].cycles;
+
+        std::set<uint32_t> seen;
+        for (size_t n = i; ; n = nodes[n].parent) {
+            if (seen.insert(nodes[n].function).second) {
+                functions[nodes[n].function].second += nodes[i].cycles;
+            }
+            if (n == 0) {
+                break;
+            }
+        }
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> by_total;
+    for (const auto& function : functions) {
+        by_total.push_back(std::make_pair(function.second.second, function.first));
+    }
+    std::sort(by_total.begin(), by_total.end(), std::greater<std::pair<uint64_t, uint32_t>>());
+
+    out << "\nhottest functions, self cycles and self/inclusive share:\n";
+    for (size_t i = 0; i < std::min(top, by_total.size()); i++) {
+        const auto& cycles = functions[by_total[i].second];
+        std::snprintf(line, sizeof(line), "%12llu %6.2f%% %6.2f%%  %s\n",
+            static_cast<unsigned long long>(cycles.first), 100.0 * cycles.first / total,
+            100.0 * cycles.second / total, function_name(by_total[i].second, symbols).c_str());
+        out << line;
+    }
+}
@@ -0,0 +1,301 @@
+/*
+ * recorder_frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "recorder_frame_sink.hpp"
+#include "clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+
+const size_t kRecorderQueueFrames = 64;
+
+const int kPngBitDepth = 2;
+const int kPngRowBytes = kScreenWidth * kPngBitDepth / 8;
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : (c >> 1);
+            }
+            entries[n] = c;
+        }
+    }
+};
+
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    static const Crc32Table table;
+
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < size; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void put_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value >> 0));
+}
+
+static void put_png_chunk(std::vector<uint8_t>& out, const char* type,
+        const std::vector<uint8_t>& data) {
+    put_u32_be(out, static_cast<uint32_t>(data.size()));
+
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32_be(out, crc32(out.data() + start, out.size() - start));
+}
+
+bool parse_record_format(const std::string& filename, RecordFormat& format) {
+    std::string extension = filename.substr(filename.find_last_of('.') + 1);
+    if (extension == "raw") {
+        format = RECORD_RAW;
+    } else if (extension == "y4m") {
+        format = RECORD_Y4M;
+    } else if (extension == "png") {
+        format = RECORD_PNG;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8_t> encode_png(const uint8_t* shades) {
+    // filter type 0 (none) and four pixels per byte, leftmost in the high bits
+    std::vector<uint8_t> pixels;
+    pixels.reserve(kScreenHeight * (kPngRowBytes + 1));
+    for (int y = 0; y < kScreenHeight; y++) {
+        pixels.push_back(0);
+        const uint8_t* row = shades + y * kScreenWidth;
+        for (int x = 0; x < kScreenWidth; x += 4) {
+            pixels.push_back(static_cast<uint8_t>(
+                ((row[x + 0] & 0x3) << 6) | ((row[x + 1] & 0x3) << 4) |
+                ((row[x + 2] & 0x3) << 2) | ((row[x + 3] & 0x3) << 0)));
+        }
+    }
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    std::vector<uint8_t> header;
+    put_u32_be(header, kScreenWidth);
+    put_u32_be(header, kScreenHeight);
+    header.push_back(kPngBitDepth);
+    header.push_back(3); // indexed color
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    put_png_chunk(png, "IHDR", header);
+
+    std::vector<uint8_t> palette;
+    for (uint32_t color : kShadePalette) {
+        palette.push_back(static_cast<uint8_t>(color >> 16));
+        palette.push_back(static_cast<uint8_t>(color >> 8));
+        palette.push_back(static_cast<uint8_t>(color >> 0));
+    }
+    put_png_chunk(png, "PLTE", palette);
+
+    // zlib header (deflate, 32K window, no preset dictionary) and stored
+    // deflate blocks of at most 65535 bytes
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    size_t offset = 0;
+    do {
+        size_t size = std::min<size_t>(pixels.size() - offset, 0xffff);
+        bool last = offset + size == pixels.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size));
+        zlib.push_back(static_cast<uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), pixels.begin() + offset, pixels.begin() + offset + size);
+        offset += size;
+    } while (offset < pixels.size());
+    put_u32_be(zlib, adler32(pixels.data(), pixels.size()));
+    put_png_chunk(png, "IDAT", zlib);
+
+    put_png_chunk(png, "IEND", std::vector<uint8_t>());
+    return png;
+}
+
+RecorderFrameSink::RecorderFrameSink(const std::string& filename, RecordFormat format) :
+    format(format), filename(filename), opened(false),
+    queue(kRecorderQueueFrames, Frame{0, 0, std::vector<uint8_t>(kScreenSize, 0)}),
+    frames_received(0), stalls(0), encoding(false),
+    previous(kScreenSize, 0), has_previous(false), first_timestamp(0), frames_written(0) {
+
+    if (format != RECORD_PNG) {
+        output.open(filename, std::ofstream::out | std::ofstream::binary);
+        if (!output.is_open()) {
+            return;
+        }
+    }
+
+    timecodes.open(filename + ".timecodes", std::ofstream::out);
+    if (!timecodes.is_open()) {
+        return;
+    }
+    timecodes << "# timecode format v2\n";
+    timecodes << std::fixed << std::setprecision(3);
+
+    if (format == RECORD_Y4M) {
+        // the nominal rate, the timecodes have the real timing. Samples
+        // are full range, players assume limited range without the tag.
+        output << "YUV4MPEG2 W" << kScreenWidth << " H" << kScreenHeight
+               << " F" << kTicksPerSecond << ":" << kTicksPerLcdFrame
+               << " Ip A1:1 C444 XCOLORRANGE=FULL\n";
+    }
+
+    opened = true;
+    encoding = true;
+    encode_thread = std::thread(&RecorderFrameSink::encode_loop, this);
+}
+
+RecorderFrameSink::~RecorderFrameSink() {
+    close();
+}
+
+void RecorderFrameSink::close() {
+    if (encode_thread.joinable()) {
+        encoding = false;
+        encode_signal.notify_one();
+        encode_thread.join();
+    }
+
+    if (output.is_open()) {
+        output.close();
+    }
+
+    if (timecodes.is_open()) {
+        timecodes.close();
+    }
+}
+
+void RecorderFrameSink::present(const uint8_t* shades, uint64_t timestamp) {
+    if (!encoding) {
+        return;
+    }
+
+    Frame* frame = queue.write_slot();
+    if (!frame) {
+        stalls += 1;
+        do {
+            encode_signal.notify_one();
+            std::this_thread::yield();
+            frame = queue.write_slot();
+        } while (!frame);
+    }
+
+    frame->number = frames_received++;
+    frame->timestamp = timestamp;
+    std::copy(shades, shades + kScreenSize, frame->shades.begin());
+    queue.push();
+    encode_signal.notify_one();
+}
+
+void RecorderFrameSink::encode_loop() {
+    while (true) {
+        {
+            // a missed notification only delays the frame until the timeout
+            std::unique_lock<std::mutex> lock(encode_mutex);
+            encode_signal.wait_for(lock, std::chrono::milliseconds(5), [this] {
+                return !queue.empty() || !encoding;
+            });
+        }
+
+        // drain everything queued, also after close() was called
+        bool stopping = !encoding;
+        while (const Frame* frame = queue.read_slot()) {
+            encode(*frame);
+            queue.pop();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    output.flush();
+    timecodes.flush();
+}
+
+void RecorderFrameSink::encode(const Frame& frame) {
+    if (has_previous && std::equal(previous.begin(), previous.end(), frame.shades.begin())) {
+        return;
+    }
+    if (!has_previous) {
+        first_timestamp = frame.timestamp;
+    }
+    previous = frame.shades;
+    has_previous = true;
+
+    double millis = (frame.timestamp - first_timestamp) * 1000.0 / kTicksPerSecond;
+    timecodes << millis << "\n";
+
+    switch (format) {
+        case RECORD_RAW:
+            output.write(reinterpret_cast<const char*>(frame.shades.data()), kScreenSize);
+            break;
+
+        case RECORD_Y4M: {
+            // full range BT.601, computed once per shade
+            uint8_t yuv[3][4];
+            for (int i = 0; i < 4; i++) {
+                double r = (kShadePalette[i] >> 16) & 0xff;
+                double g = (kShadePalette[i] >> 8) & 0xff;
+                double b = (kShadePalette[i] >> 0) & 0xff;
+                yuv[0][i] = static_cast<uint8_t>(0.299 * r + 0.587 * g + 0.114 * b + 0.5);
+                yuv[1][i] = static_cast<uint8_t>(128.5 - 0.168736 * r - 0.331264 * g + 0.5 * b);
+                yuv[2][i] = static_cast<uint8_t>(128.5 + 0.5 * r - 0.418688 * g - 0.081312 * b);
+            }
+
+            encoded.resize(kScreenSize * 3);
+            for (int plane = 0; plane < 3; plane++) {
+                uint8_t* out = encoded.data() + plane * kScreenSize;
+                for (int i = 0; i < kScreenSize; i++) {
+                    out[i] = yuv[plane][frame.shades[i] & 0x3];
+                }
+            }
+
+            output << "FRAME\n";
+            output.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+            break;
+        }
+
+        case RECORD_PNG: {
+            std::string stem = filename.substr(0, filename.find_last_of('.'));
+            char number[16];
+            std::snprintf(number, sizeof(number), "_%06llu.png",
+                static_cast<unsigned long long>(frame.number));
+
+            encoded = encode_png(frame.shades.data());
+            std::ofstream png(stem + number, std::ofstream::out | std::ofstream::binary);
+            png.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+            break;
+        }
+    }
+
+    frames_written += 1;
+}
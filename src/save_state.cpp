@@ -0,0 +1,98 @@
+/*
+ * save_state.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+
+// a state is about 64kB plus cartridge RAM, reserving avoids regrowing
+const size_t kSaveStateReserve = 96 * 1024;
+
+void save_state(const GBCPU& cpu, const GBGPU& gpu, std::vector<uint8_t>& buffer) {
+    buffer.clear();
+    buffer.reserve(kSaveStateReserve);
+
+    GBStateWriter writer(buffer);
+
+    SaveStateHeader header = {};
+    std::copy(kSaveStateMagic, kSaveStateMagic + sizeof(header.magic), header.magic);
+    header.version = kSaveStateVersion;
+    writer.write(header);
+
+    cpu.save_state(writer);
+    cpu.mmu.save_state(writer);
+    gpu.save_state(writer);
+
+    uint32_t size = static_cast<uint32_t>(buffer.size());
+    std::memcpy(buffer.data() + offsetof(SaveStateHeader, size), &size, sizeof(size));
+}
+
+static bool read_state(GBCPU& cpu, GBGPU& gpu, const uint8_t* data, size_t size, std::string& error) {
+    GBStateReader reader(data, size);
+
+    SaveStateHeader header;
+    if (!reader.read(header) || std::memcmp(header.magic, kSaveStateMagic, sizeof(header.magic)) != 0) {
+        error = "not a save state";
+        return false;
+    }
+    if (header.version != kSaveStateVersion) {
+        error = "save state version " + std::to_string(header.version) + " isn't supported";
+        return false;
+    }
+    if (header.size != size) {
+        error = "save state is truncated";
+        return false;
+    }
+
+    cpu.load_state(reader);
+    cpu.mmu.load_state(reader);
+    gpu.load_state(reader);
+
+    if (reader.is_ok() && reader.get_remaining() != 0) {
+        reader.fail("save state has trailing data");
+    }
+    error = reader.get_error();
+    return reader.is_ok();
+}
+
+bool load_state(GBCPU& cpu, GBGPU& gpu, const uint8_t* data, size_t size, std::string& error) {
+    // sections are applied as they are read, a problem halfway puts back
+    // the machine as it was
+    std::vector<uint8_t> previous;
+    save_state(cpu, gpu, previous);
+
+    if (read_state(cpu, gpu, data, size, error)) {
+        return true;
+    }
+
+    std::string ignored;
+    read_state(cpu, gpu, previous.data(), previous.size(), ignored);
+    return false;
+}
+
+bool save_state_file(const std::string& filename, const GBCPU& cpu, const GBGPU& gpu) {
+    std::vector<uint8_t> buffer;
+    save_state(cpu, gpu, buffer);
+
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return static_cast<bool>(file);
+}
+
+bool load_state_file(const std::string& filename, GBCPU& cpu, GBGPU& gpu, std::string& error) {
+    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+    if (!file.is_open()) {
+        error = "could not open " + filename;
+        return false;
+    }
+
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return load_state(cpu, gpu, buffer.data(), buffer.size(), error);
+}
@@ -0,0 +1,306 @@
+/*
+ * scaler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "scaler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const int kMaxScaleFactor = 8;
+
+bool parse_scale_filter(const std::string& name, ScaleFilter& filter, int& factor) {
+    if (name == "scale2x") {
+        filter = SCALE_2X;
+        factor = 2;
+        return true;
+    }
+
+    if (name == "scale3x") {
+        filter = SCALE_3X;
+        factor = 3;
+        return true;
+    }
+
+    if (name.size() == 2 && name[1] == 'x' && name[0] >= '1' && name[0] <= '0' + kMaxScaleFactor) {
+        filter = SCALE_NEAREST;
+        factor = name[0] - '0';
+        return true;
+    }
+
+    return false;
+}
+
+#if defined(__SSE2__)
+static inline __m128i select_si128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+static void nearest_row(const uint32_t* src, uint32_t* out, int factor) {
+    int x = 0;
+
+#if defined(__SSE2__)
+    if (factor == 2) {
+        for (; x + 4 <= kScreenWidth; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            __m128i* dst = reinterpret_cast<__m128i*>(out + x * 2);
+            _mm_storeu_si128(dst + 0, _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi32(v, v));
+        }
+    } else if (factor == 4) {
+        for (; x + 4 <= kScreenWidth; x += 4) {
+            __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            __m128i lo = _mm_unpacklo_epi32(v, v);
+            __m128i hi = _mm_unpackhi_epi32(v, v);
+            __m128i* dst = reinterpret_cast<__m128i*>(out + x * 4);
+            _mm_storeu_si128(dst + 0, _mm_unpacklo_epi64(lo, lo));
+            _mm_storeu_si128(dst + 1, _mm_unpackhi_epi64(lo, lo));
+            _mm_storeu_si128(dst + 2, _mm_unpacklo_epi64(hi, hi));
+            _mm_storeu_si128(dst + 3, _mm_unpackhi_epi64(hi, hi));
+        }
+    }
+#endif
+
+    for (; x < kScreenWidth; x++) {
+        std::fill(out + x * factor, out + (x + 1) * factor, src[x]);
+    }
+}
+
+// Scale2x, each pixel E with neighbours B (above), D (left), F (right) and
+// H (below) becomes
+//
+//   E0 E1    E0 = D if D == B, else E    E1 = F if B == F, else E
+//   E2 E3    E2 = D if D == H, else E    E3 = F if H == F, else E
+//
+// but only when B != H and D != F, otherwise all four are E.
+static inline void scale2x_pixel(const uint32_t* above, const uint32_t* row,
+        const uint32_t* below, int x, uint32_t* out0, uint32_t* out1) {
+    uint32_t B = above[x];
+    uint32_t H = below[x];
+    uint32_t E = row[x];
+    uint32_t D = row[x > 0 ? x - 1 : x];
+    uint32_t F = row[x < kScreenWidth - 1 ? x + 1 : x];
+
+    if (B != H && D != F) {
+        out0[x * 2 + 0] = D == B ? D : E;
+        out0[x * 2 + 1] = B == F ? F : E;
+        out1[x * 2 + 0] = D == H ? D : E;
+        out1[x * 2 + 1] = H == F ? F : E;
+    } else {
+        out0[x * 2 + 0] = E;
+        out0[x * 2 + 1] = E;
+        out1[x * 2 + 0] = E;
+        out1[x * 2 + 1] = E;
+    }
+}
+
+static void scale2x_row(const uint32_t* above, const uint32_t* row,
+        const uint32_t* below, uint32_t* out0, uint32_t* out1) {
+    int x = 0;
+    scale2x_pixel(above, row, below, x++, out0, out1);
+
+#if defined(__SSE2__)
+    // four pixels at a time, F is read up to x + 4
+    for (; x + 4 < kScreenWidth; x += 4) {
+        __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+        __m128i H = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x));
+        __m128i E = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        __m128i D = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+        __m128i F = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+
+        __m128i edge = _mm_andnot_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)),
+            _mm_set1_epi32(-1));
+
+        __m128i E0 = select_si128(_mm_and_si128(edge, _mm_cmpeq_epi32(D, B)), D, E);
+        __m128i E1 = select_si128(_mm_and_si128(edge, _mm_cmpeq_epi32(B, F)), F, E);
+        __m128i E2 = select_si128(_mm_and_si128(edge, _mm_cmpeq_epi32(D, H)), D, E);
+        __m128i E3 = select_si128(_mm_and_si128(edge, _mm_cmpeq_epi32(H, F)), F, E);
+
+        __m128i* dst0 = reinterpret_cast<__m128i*>(out0 + x * 2);
+        __m128i* dst1 = reinterpret_cast<__m128i*>(out1 + x * 2);
+        _mm_storeu_si128(dst0 + 0, _mm_unpacklo_epi32(E0, E1));
+        _mm_storeu_si128(dst0 + 1, _mm_unpackhi_epi32(E0, E1));
+        _mm_storeu_si128(dst1 + 0, _mm_unpacklo_epi32(E2, E3));
+        _mm_storeu_si128(dst1 + 1, _mm_unpackhi_epi32(E2, E3));
+    }
+#endif
+
+    for (; x < kScreenWidth; x++) {
+        scale2x_pixel(above, row, below, x, out0, out1);
+    }
+}
+
+// Scale3x, with A B C / D E F / G H I around E, when B != H and D != F
+//
+//   E0 E1 E2    E0 = D if D == B             E1 = B if (D == B && E != C) || (B == F && E != A)
+//   E3 E4 E5    E2 = F if B == F             E3 = D if (D == B && E != G) || (D == H && E != A)
+//   E6 E7 E8    E4 = E                       E5 = F if (B == F && E != I) || (H == F && E != C)
+//               E6 = D if D == H             E7 = H if (D == H && E != I) || (H == F && E != G)
+//               E8 = F if H == F
+//
+// The interleaved three pixel output does not map well to SSE2 shuffles,
+// so this one is left to the compiler.
+static void scale3x_row(const uint32_t* above, const uint32_t* row,
+        const uint32_t* below, uint32_t* out0, uint32_t* out1, uint32_t* out2) {
+    for (int x = 0; x < kScreenWidth; x++) {
+        int left  = x > 0 ? x - 1 : x;
+        int right = x < kScreenWidth - 1 ? x + 1 : x;
+
+        uint32_t A = above[left], B = above[x], C = above[right];
+        uint32_t D = row[left],   E = row[x],   F = row[right];
+        uint32_t G = below[left], H = below[x], I = below[right];
+
+        uint32_t* p0 = out0 + x * 3;
+        uint32_t* p1 = out1 + x * 3;
+        uint32_t* p2 = out2 + x * 3;
+
+        if (B != H && D != F) {
+            p0[0] = D == B ? D : E;
+            p0[1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+            p0[2] = B == F ? F : E;
+            p1[0] = (D == B && E != G) || (D == H && E != A) ? D : E;
+            p1[1] = E;
+            p1[2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+            p2[0] = D == H ? D : E;
+            p2[1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+            p2[2] = H == F ? F : E;
+        } else {
+            std::fill(p0, p0 + 3, E);
+            std::fill(p1, p1 + 3, E);
+            std::fill(p2, p2 + 3, E);
+        }
+    }
+}
+
+Scaler::Scaler(ScaleFilter filter, int factor, int threads) :
+    filter(filter), factor(factor), job_generation(0), pending_bands(0), running(true),
+    job_src(nullptr), job_dst(nullptr), job_pitch(0), job_first_row(0), job_last_row(0) {
+
+    if (filter == SCALE_2X) {
+        this->factor = 2;
+    } else if (filter == SCALE_3X) {
+        this->factor = 3;
+    } else {
+        this->factor = std::min(std::max(factor, 1), kMaxScaleFactor);
+    }
+
+    for (int band = 1; band < threads; band++) {
+        workers.push_back(std::thread(&Scaler::worker_loop, this, band));
+    }
+}
+
+Scaler::~Scaler() {
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        running = false;
+    }
+    job_signal.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void Scaler::scale(const uint32_t* src, uint32_t* dst, int dst_pitch,
+        int first_row, int last_row) {
+    if (workers.empty()) {
+        scale_rows(src, dst, dst_pitch, first_row, last_row);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(job_mutex);
+        job_src = src;
+        job_dst = dst;
+        job_pitch = dst_pitch;
+        job_first_row = first_row;
+        job_last_row = last_row;
+        pending_bands = static_cast<int>(workers.size());
+        job_generation += 1;
+    }
+    job_signal.notify_all();
+
+    scale_band(0);
+
+    std::unique_lock<std::mutex> lock(job_mutex);
+    done_signal.wait(lock, [this] { return pending_bands == 0; });
+}
+
+void Scaler::worker_loop(int band) {
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(job_mutex);
+            job_signal.wait(lock, [this, generation] {
+                return !running || job_generation != generation;
+            });
+            if (!running) {
+                return;
+            }
+            generation = job_generation;
+        }
+
+        scale_band(band);
+
+        {
+            std::lock_guard<std::mutex> lock(job_mutex);
+            pending_bands -= 1;
+        }
+        done_signal.notify_one();
+    }
+}
+
+void Scaler::scale_band(int band) {
+    int bands = static_cast<int>(workers.size()) + 1;
+    int rows = job_last_row - job_first_row + 1;
+    int first = job_first_row + rows * band / bands;
+    int last  = job_first_row + rows * (band + 1) / bands - 1;
+    if (first > last) {
+        return;
+    }
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(job_dst) +
+        (first - job_first_row) * factor * job_pitch;
+    scale_rows(job_src, reinterpret_cast<uint32_t*>(dst), job_pitch, first, last);
+}
+
+void Scaler::scale_rows(const uint32_t* src, uint32_t* dst, int dst_pitch,
+        int first_row, int last_row) {
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+
+    for (int y = first_row; y <= last_row; y++) {
+        const uint32_t* row   = src + y * kScreenWidth;
+        const uint32_t* above = y > 0 ? row - kScreenWidth : row;
+        const uint32_t* below = y < kScreenHeight - 1 ? row + kScreenWidth : row;
+
+        uint32_t* out0 = reinterpret_cast<uint32_t*>(out);
+        uint32_t* out1 = reinterpret_cast<uint32_t*>(out + dst_pitch);
+        uint32_t* out2 = reinterpret_cast<uint32_t*>(out + dst_pitch * 2);
+
+        switch (filter) {
+            case SCALE_2X:
+                scale2x_row(above, row, below, out0, out1);
+                break;
+            case SCALE_3X:
+                scale3x_row(above, row, below, out0, out1, out2);
+                break;
+            default:
+                nearest_row(row, out0, factor);
+                for (int i = 1; i < factor; i++) {
+                    std::memcpy(out + dst_pitch * i, out0, get_output_width() * sizeof(uint32_t));
+                }
+                break;
+        }
+
+        out += dst_pitch * factor;
+    }
+}
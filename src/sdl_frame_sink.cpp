@@ -0,0 +1,282 @@
+/*
+ * sdl_frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "sdl_frame_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// never a valid shade, forces the first frame to be uploaded in full
+const uint8_t kNoShade = 0xff;
+
+SdlFrameSink::SdlFrameSink() :
+    window(nullptr), renderer(nullptr), texture(nullptr),
+    frames(std::vector<uint8_t>(kScreenSize, 0)),
+    published(kScreenSize, kNoShade), uploaded(kScreenSize, kNoShade),
+    vsync_pacer(nullptr), presenting(false), paused(false), redraw_requested(false) {
+
+}
+
+SdlFrameSink::~SdlFrameSink() {
+    hide();
+}
+
+void SdlFrameSink::show() {
+    if (!window) {
+        window = SDL_CreateWindow(window_title.c_str(),
+            SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED,
+            scaler ? scaler->get_output_width() : kScreenWidth,
+            scaler ? scaler->get_output_height() : kScreenHeight,
+            SDL_WINDOW_SHOWN);
+
+        if (window) {
+            presenting = true;
+            present_thread = std::thread(&SdlFrameSink::present_loop, this);
+            black();
+        } else {
+            std::cerr << "SDL_CreateWindow failed: " << SDL_GetError() << "\n";
+        }
+    }
+}
+
+void SdlFrameSink::hide() {
+    if (present_thread.joinable()) {
+        presenting = false;
+        wake();
+        present_thread.join();
+    }
+
+    if (window) {
+        SDL_DestroyWindow(window);
+        window = nullptr;
+    }
+}
+
+void SdlFrameSink::blank() {
+    fill(0);
+}
+
+void SdlFrameSink::black() {
+    fill(3);
+}
+
+void SdlFrameSink::fill(uint8_t shade) {
+    if (!presenting) {
+        return;
+    }
+
+    std::fill(published.begin(), published.end(), shade);
+
+    auto& frame = frames.back_buffer();
+    std::fill(frame.begin(), frame.end(), shade);
+    frames.publish();
+    wake();
+}
+
+// Taking the lock orders the notification after the present thread
+// checked for work, so a paused thread waiting without timeout can't miss it
+void SdlFrameSink::wake() {
+    {
+        std::lock_guard<std::mutex> lock(present_mutex);
+    }
+    present_signal.notify_one();
+}
+
+void SdlFrameSink::pause() {
+    paused = true;
+}
+
+void SdlFrameSink::resume() {
+    paused = false;
+    wake();
+}
+
+void SdlFrameSink::redraw() {
+    {
+        std::lock_guard<std::mutex> lock(present_mutex);
+        redraw_requested = true;
+    }
+    present_signal.notify_one();
+}
+
+void SdlFrameSink::present(const uint8_t* shades, uint64_t timestamp) {
+    if (!presenting) {
+        return;
+    }
+
+    if (std::equal(shades, shades + kScreenSize, published.begin())) {
+        return;
+    }
+    std::copy(shades, shades + kScreenSize, published.begin());
+
+    auto& frame = frames.back_buffer();
+    std::copy(shades, shades + kScreenSize, frame.begin());
+    frames.publish();
+    wake();
+}
+
+void SdlFrameSink::present_loop() {
+    renderer = SDL_CreateRenderer(window, -1, vsync_pacer ? SDL_RENDERER_PRESENTVSYNC : 0);
+    if (!renderer) {
+        std::cerr << "SDL_CreateRenderer failed: " << SDL_GetError() << "\n";
+        return;
+    }
+
+    texture = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        scaler ? scaler->get_output_width() : kScreenWidth,
+        scaler ? scaler->get_output_height() : kScreenHeight);
+
+    while (presenting) {
+        if (paused) {
+            std::unique_lock<std::mutex> lock(present_mutex);
+            present_signal.wait(lock, [this] {
+                return frames.has_update() || redraw_requested || !paused || !presenting;
+            });
+            if (!paused || !presenting) {
+                continue;
+            }
+            redraw_requested = false;
+            lock.unlock();
+
+            if (frames.update()) {
+                const auto& frame = frames.front_buffer();
+
+                int first_row = 0;
+                int last_row = 0;
+                if (find_changed_rows(uploaded.data(), frame.data(), first_row, last_row)) {
+                    upload_rows(frame, first_row, last_row);
+                }
+            }
+            render();
+            continue;
+        }
+
+        if (vsync_pacer) {
+            // SDL_RenderPresent waits for the refresh
+            if (frames.update()) {
+                const auto& frame = frames.front_buffer();
+
+                int first_row = 0;
+                int last_row = 0;
+                if (find_changed_rows(uploaded.data(), frame.data(), first_row, last_row)) {
+                    upload_rows(frame, first_row, last_row);
+                }
+            }
+
+            render();
+            vsync_pacer->vsync();
+            continue;
+        }
+
+        {
+            // a missed notification only delays the frame until the timeout
+            std::unique_lock<std::mutex> lock(present_mutex);
+            present_signal.wait_for(lock, std::chrono::milliseconds(5), [this] {
+                return frames.has_update() || !presenting;
+            });
+        }
+
+        if (!frames.update()) {
+            continue;
+        }
+
+        const auto& frame = frames.front_buffer();
+
+        int first_row = 0;
+        int last_row = 0;
+        if (!find_changed_rows(uploaded.data(), frame.data(), first_row, last_row)) {
+            continue;
+        }
+
+        upload_rows(frame, first_row, last_row);
+        render();
+    }
+
+    SDL_DestroyTexture(texture);
+    texture = nullptr;
+
+    SDL_DestroyRenderer(renderer);
+    renderer = nullptr;
+}
+
+void SdlFrameSink::render() {
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    SDL_RenderPresent(renderer);
+}
+
+void SdlFrameSink::upload_rows(const std::vector<uint8_t>& frame, int first_row, int last_row) {
+    for (int row = first_row; row <= last_row; row++) {
+        const uint8_t* line = frame.data() + row * kScreenWidth;
+        std::copy(line, line + kScreenWidth, uploaded.begin() + row * kScreenWidth);
+    }
+
+    int pitch = 0;
+    uint8_t* pixels = nullptr;
+
+    if (!scaler) {
+        SDL_Rect rows = {0, first_row, kScreenWidth, last_row - first_row + 1};
+        SDL_LockTexture(texture, &rows,
+            reinterpret_cast<void **>(&pixels), &pitch);
+
+        for (int row = first_row; row <= last_row; row++) {
+            expand_shades(frame.data() + row * kScreenWidth,
+                reinterpret_cast<Uint32*>(pixels), kScreenWidth);
+            pixels += pitch;
+        }
+
+        SDL_UnlockTexture(texture);
+        return;
+    }
+
+    expand_shades(frame.data() + first_row * kScreenWidth,
+        argb.data() + first_row * kScreenWidth,
+        (last_row - first_row + 1) * kScreenWidth);
+
+    // filters reading neighbour pixels also change the rows next to them
+    first_row = std::max(first_row - scaler->get_border(), 0);
+    last_row  = std::min(last_row + scaler->get_border(), kScreenHeight - 1);
+
+    int factor = scaler->get_factor();
+    SDL_Rect rows = {0, first_row * factor,
+        scaler->get_output_width(), (last_row - first_row + 1) * factor};
+    SDL_LockTexture(texture, &rows,
+        reinterpret_cast<void **>(&pixels), &pitch);
+
+    scaler->scale(argb.data(), reinterpret_cast<uint32_t*>(pixels), pitch,
+        first_row, last_row);
+
+    SDL_UnlockTexture(texture);
+}
+
+void SdlFrameSink::set_scaler(ScaleFilter filter, int factor, int threads) {
+    if (window) {
+        return;
+    }
+
+    scaler.reset(new Scaler(filter, factor, threads));
+    argb.assign(kScreenSize, kShadePalette[0]);
+}
+
+void SdlFrameSink::set_vsync(FramePacer* pacer) {
+    if (window) {
+        return;
+    }
+
+    vsync_pacer = pacer;
+}
+
+void SdlFrameSink::set_window_title(const std::string& title) {
+    window_title = title;
+    if (window) {
+        SDL_SetWindowTitle(window, window_title.c_str());
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * speed_control.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "speed_control.hpp"
+
+#include <cstdlib>
+#include <sstream>
+
+// kUnlimitedSpeed last, it is the fastest
+const double kSpeedSteps[] = {0.25, 0.5, 1, 2, 4, 8, kUnlimitedSpeed};
+const int kSpeedStepCount = sizeof(kSpeedSteps) / sizeof(kSpeedSteps[0]);
+
+bool parse_speed(const std::string& text, double& speed) {
+    if (text == "unlimited") {
+        speed = kUnlimitedSpeed;
+        return true;
+    }
+
+    std::string number = text;
+    if (!number.empty() && number.back() == 'x') {
+        number.pop_back();
+    }
+
+    char* end = nullptr;
+    double value = std::strtod(number.c_str(), &end);
+    if (number.empty() || *end != '\0' || !(value > 0)) {
+        return false;
+    }
+
+    speed = value;
+    return true;
+}
+
+std::string format_speed(double speed) {
+    if (speed == kUnlimitedSpeed) {
+        return "unlimited";
+    }
+
+    std::ostringstream out;
+    out.precision(3);
+    out << speed << "x";
+    return out.str();
+}
+
+SpeedControl::SpeedControl(double speed, double turbo_speed) :
+    selected(speed), turbo(turbo_speed), turbo_held(false), turbo_toggled(false) {
+
+}
+
+void SpeedControl::faster() {
+    if (selected == kUnlimitedSpeed) {
+        return;
+    }
+
+    for (int step = 0; step < kSpeedStepCount - 1; step++) {
+        if (kSpeedSteps[step] > selected) {
+            selected = kSpeedSteps[step];
+            return;
+        }
+    }
+    selected = kUnlimitedSpeed;
+}
+
+void SpeedControl::slower() {
+    if (selected == kUnlimitedSpeed) {
+        selected = kSpeedSteps[kSpeedStepCount - 2];
+        return;
+    }
+
+    for (int step = kSpeedStepCount - 2; step >= 0; step--) {
+        if (kSpeedSteps[step] < selected) {
+            selected = kSpeedSteps[step];
+            return;
+        }
+    }
+}
+
+uint32_t SpeedControl::get_frame_skip(double measured_speed) const {
+    double speed = get_speed();
+    if (speed == kUnlimitedSpeed) {
+        speed = measured_speed;
+    }
+    return speed > 1.5 ? static_cast<uint32_t>(speed + 0.5) : 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * symbols.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "symbols.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool GBSymbols::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "error: could not open " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find(';');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream stream(line);
+        std::string where, name;
+        if (!(stream >> where >> name)) {
+            continue;
+        }
+
+        size_t colon = where.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        uint32_t bank = std::strtoul(where.substr(0, colon).c_str(), nullptr, 16);
+        uint16_t addr = static_cast<uint16_t>(std::strtoul(where.substr(colon + 1).c_str(), nullptr, 16));
+        add(bank, addr, name);
+    }
+    return true;
+}
+
+void GBSymbols::add(uint32_t bank, uint16_t addr, const std::string& name) {
+    // the first label at an address wins, later ones are usually locals
+    symbols.insert(std::make_pair(key(bank, addr), name));
+}
+
+std::string GBSymbols::exact(uint32_t bank, uint16_t addr) const {
+    auto it = symbols.find(key(bank, addr));
+    return (it != symbols.end()) ? it->second : std::string();
+}
+
+std::string GBSymbols::describe(uint32_t bank, uint16_t addr) const {
+    uint32_t wanted = key(bank, addr);
+    auto it = symbols.upper_bound(wanted);
+
+    // only a symbol in the same bank and region describes the address
+    if (it != symbols.begin()) {
+        --it;
+        uint32_t found = it->first;
+        bool same_region = (found >> 14) == (wanted >> 14);
+        if (same_region) {
+            if (found == wanted) {
+                return it->second;
+            }
+            char offset[16];
+            std::snprintf(offset, sizeof(offset), "+0x%x", wanted - found);
+            return it->second + offset;
+        }
+    }
+
+    char name[16];
+    std::snprintf(name, sizeof(name), "%02x:%04x", (addr >= 0x4000 && addr < 0x8000) ? bank : 0, addr);
+    return std::string(name);
+}
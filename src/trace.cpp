@@ -0,0 +1,188 @@
+/*
+ * trace.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include "trace.hpp"
+#include "instruction.hpp"
+
+#include <chrono>
+#include <cstring>
+
+const size_t kTraceBlockEntries = 4096;
+const size_t kTraceQueueBlocks  = 16;
+
+bool parse_trace_mode(const std::string& name, TraceMode& mode) {
+    if (name == "full") {
+        mode = TRACE_FULL;
+    } else if (name == "branch") {
+        mode = TRACE_BRANCH;
+    } else if (name == "memory") {
+        mode = TRACE_MEMORY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string format_trace_entry(const TraceEntry& entry) {
+    char line[128];
+    if (entry.kind == TRACE_INSTRUCTION) {
+        std::snprintf(line, sizeof(line),
+            "cycle:%llu bank:%02x pc:%04x op:%02x af:%04x bc:%04x de:%04x hl:%04x sp:%04x",
+            static_cast<unsigned long long>(entry.cycle), entry.bank, entry.pc, entry.opcode,
+            entry.af, entry.bc, entry.de, entry.hl, entry.sp);
+    } else {
+        std::snprintf(line, sizeof(line), "cycle:%llu %s %04x = %02x",
+            static_cast<unsigned long long>(entry.cycle),
+            entry.kind == TRACE_MEMORY_READ ? "read " : "write", entry.pc, entry.opcode);
+    }
+    return std::string(line);
+}
+
+GBTraceRecorder::GBTraceRecorder(const std::string& filename, TraceMode mode) :
+    mode(mode), file(nullptr),
+    queue(kTraceQueueBlocks, Block{std::vector<TraceEntry>(kTraceBlockEntries), 0}),
+    block(nullptr), entry_count(0), stalls(0),
+    next_pc(0), has_next_pc(false), fetching(false), cycle(0), writing(false) {
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+
+    TraceHeader header;
+    std::memcpy(header.magic, kTraceMagic, sizeof(header.magic));
+    header.version = kTraceVersion;
+    header.entry_size = kTraceEntrySize;
+    header.mode = mode;
+    header.reserved = 0;
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    block = queue.write_slot();
+    block->size = 0;
+
+    writing = true;
+    write_thread = std::thread(&GBTraceRecorder::write_loop, this);
+}
+
+GBTraceRecorder::~GBTraceRecorder() {
+    close();
+}
+
+void GBTraceRecorder::close() {
+    if (!write_thread.joinable()) {
+        return;
+    }
+
+    if (block->size > 0) {
+        flush_block();
+    }
+
+    writing = false;
+    write_signal.notify_one();
+    write_thread.join();
+
+    std::fclose(file);
+    file = nullptr;
+}
+
+void GBTraceRecorder::flush_block() {
+    queue.push();
+    write_signal.notify_one();
+
+    block = queue.write_slot();
+    if (!block) {
+        stalls += 1;
+        do {
+            write_signal.notify_one();
+            std::this_thread::yield();
+            block = queue.write_slot();
+        } while (!block);
+    }
+    block->size = 0;
+}
+
+void GBTraceRecorder::write_loop() {
+    while (true) {
+        {
+            // a missed notification only delays the write until the timeout
+            std::unique_lock<std::mutex> lock(write_mutex);
+            write_signal.wait_for(lock, std::chrono::milliseconds(5), [this] {
+                return !queue.empty() || !writing;
+            });
+        }
+
+        // drain everything queued, also after close() was called
+        bool stopping = !writing;
+        while (const Block* full = queue.read_slot()) {
+            std::fwrite(full->entries.data(), kTraceEntrySize, full->size, file);
+            queue.pop();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+void GBTraceRecorder::record_instruction(const GBCPU& cpu, uint64_t cycle) {
+    this->cycle = cycle;
+
+    uint16_t pc = cpu.reg.pc;
+    if (mode == TRACE_BRANCH && has_next_pc && pc == next_pc) {
+        // fell through, only the opcode is needed to know where to next
+        fetching = true;
+        next_pc = pc + Instruction::length(cpu.mmu.read_byte(pc));
+        fetching = false;
+        return;
+    }
+
+    fetching = true;
+    uint8_t opcode = cpu.mmu.read_byte(pc);
+    fetching = false;
+
+    next_pc = pc + Instruction::length(opcode);
+    has_next_pc = true;
+
+    TraceEntry entry;
+    entry.cycle  = cycle;
+    entry.pc     = pc;
+    entry.af     = cpu.reg.af;
+    entry.bc     = cpu.reg.bc;
+    entry.de     = cpu.reg.de;
+    entry.hl     = cpu.reg.hl;
+    entry.sp     = cpu.reg.sp;
+    entry.opcode = opcode;
+    entry.kind   = TRACE_INSTRUCTION;
+    entry.bank   = static_cast<uint16_t>(cpu.mmu.get_rom_bank());
+    append(entry);
+}
+
+void GBTraceRecorder::memory_read(uint16_t addr, uint8_t value) {
+    if (mode != TRACE_MEMORY || fetching) {
+        return;
+    }
+
+    TraceEntry entry = TraceEntry();
+    entry.cycle  = cycle;
+    entry.pc     = addr;
+    entry.opcode = value;
+    entry.kind   = TRACE_MEMORY_READ;
+    append(entry);
+}
+
+void GBTraceRecorder::memory_write(uint16_t addr, uint8_t value) {
+    if (mode != TRACE_MEMORY) {
+        return;
+    }
+
+    TraceEntry entry = TraceEntry();
+    entry.cycle  = cycle;
+    entry.pc     = addr;
+    entry.opcode = value;
+    entry.kind   = TRACE_MEMORY_WRITE;
+    append(entry);
+}
@@ -7,6 +7,15 @@
 
 #include "utils.hpp"
 
+#include <cstring>
+
+const uint64_t kHashPrime1 = 0x9e3779b185ebca87ULL;
+const uint64_t kHashPrime2 = 0xc2b2ae3d27d4eb4fULL;
+
+inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
 std::stringstream print_bytes(const std::vector<uint8_t>& data) {
     std::stringstream ss;
     ss << std::setfill('0');
@@ -42,3 +51,27 @@ std::vector<std::string> text_to_line_vector(std::stringstream& ss) {
     return lines;
 }
 
+uint64_t hash64(const uint8_t* data, size_t size, uint64_t seed) {
+    uint64_t h = seed ^ (size * kHashPrime1);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h ^= rotate_left(word * kHashPrime2, 31) * kHashPrime1;
+        h = rotate_left(h, 27) * kHashPrime1 + kHashPrime2;
+    }
+
+    for (; i < size; i++) {
+        h ^= data[i] * kHashPrime1;
+        h = rotate_left(h, 11) * kHashPrime2;
+    }
+
+    // final avalanche, every input bit affects every output bit
+    h ^= h >> 33;
+    h *= kHashPrime2;
+    h ^= h >> 29;
+    h *= kHashPrime1;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,139 @@
+/*
+ * test/breakpoints.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define BREAKPOINTS_TEST "[Breakpoints]"
+
+#include "catch.hpp"
+#include "breakpoints.hpp"
+
+// nop, ld a,(0xc100), inc a, ld (0xc101),a, jr -9 back to the first nop
+void load_program(GBMMU& mmu, GBCPU& cpu) {
+    const uint8_t program[] = {0x00, 0xfa, 0x00, 0xc1, 0x3c, 0xea, 0x01, 0xc1, 0x18, 0xf6};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mmu.write_byte(0xc000 + i, program[i]);
+    }
+    mmu.write_byte(0xc100, 0x41);
+    cpu.reg.pc = 0xc000;
+}
+
+// Steps until a breakpoint stops execution, returns the instructions run
+int run_until_break(GBCPU& cpu, GBBreakpoints& breakpoints, int limit = 100) {
+    for (int i = 0; i < limit; i++) {
+        if (breakpoints.check(cpu.reg.pc)) {
+            return i;
+        }
+        cpu.step();
+    }
+    return -1;
+}
+
+TEST_CASE("Breakpoint Conditions", BREAKPOINTS_TEST) {
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+    cpu.reg.a = 0x10;
+    cpu.reg.hl = 0xc123;
+    mmu.write_byte(0xc000, 0x99);
+
+    std::string error;
+    BreakCondition condition;
+
+    REQUIRE(BreakCondition::compile("", condition, error));
+    REQUIRE(condition.evaluate(cpu, 0));
+
+    REQUIRE(BreakCondition::compile("a == 0x10 && hl >= 0xc000 && value != 0", condition, error));
+    REQUIRE(condition.evaluate(cpu, 1));
+    REQUIRE_FALSE(condition.evaluate(cpu, 0));
+
+    REQUIRE(BreakCondition::compile("[c000] == 153", condition, error));
+    REQUIRE(condition.evaluate(cpu, 0));
+
+    REQUIRE_FALSE(BreakCondition::compile("a = 1", condition, error));
+    REQUIRE_FALSE(BreakCondition::compile("q == 1", condition, error));
+    REQUIRE_FALSE(BreakCondition::compile("a == 1 &&", condition, error));
+    REQUIRE_FALSE(BreakCondition::compile("a == 1 || b == 2", condition, error));
+}
+
+// Counts the accesses it sees, like a memory trace would record them
+class CountingObserver : public GBMemoryObserver {
+public:
+    int reads = 0;
+    int writes = 0;
+
+    virtual void memory_read(uint16_t, uint8_t) override { reads++; }
+    virtual void memory_write(uint16_t, uint8_t) override { writes++; }
+};
+
+TEST_CASE("Breakpoint Engine", BREAKPOINTS_TEST) {
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+    load_program(mmu, cpu);
+    GBBreakpoints breakpoints(cpu);
+    std::string error;
+
+    SECTION("nothing armed never stops and installs no observer") {
+        REQUIRE_FALSE(breakpoints.is_armed());
+        REQUIRE(run_until_break(cpu, breakpoints) == -1);
+    }
+
+    SECTION("execute stops before the instruction and resumes past it") {
+        uint32_t id = breakpoints.add("x c004", error);
+        REQUIRE(id != 0);
+        REQUIRE(run_until_break(cpu, breakpoints) == 2);
+        REQUIRE(cpu.reg.pc == 0xc004);
+        REQUIRE(breakpoints.get_hit().id == id);
+        REQUIRE(breakpoints.get_hit().kind == BREAK_EXECUTE);
+
+        breakpoints.resume();
+        REQUIRE(run_until_break(cpu, breakpoints) == 5);
+        REQUIRE(breakpoints.get_breakpoints()[0].hits == 2);
+
+        REQUIRE(breakpoints.remove(id));
+        REQUIRE_FALSE(breakpoints.is_armed());
+    }
+
+    SECTION("watchpoints stop after the accessing instruction") {
+        REQUIRE(breakpoints.add("r c100", error) != 0);
+        REQUIRE(run_until_break(cpu, breakpoints) == 2);
+        REQUIRE(breakpoints.get_hit().kind == BREAK_READ);
+        REQUIRE(breakpoints.get_hit().value == 0x41);
+        REQUIRE(cpu.reg.pc == 0xc004);
+
+        breakpoints.clear();
+        REQUIRE(breakpoints.add("w c0f0-c1ff if value == 0x43", error) != 0);
+        REQUIRE(run_until_break(cpu, breakpoints) == -1);
+
+        breakpoints.clear();
+        REQUIRE(breakpoints.add("w c0f0-c1ff if value == 0x42", error) != 0);
+        REQUIRE(run_until_break(cpu, breakpoints) == 2);
+        REQUIRE(breakpoints.get_hit().addr == 0xc101);
+        REQUIRE(breakpoints.get_hit().value == 0x42);
+    }
+
+    SECTION("watchpoints keep an observer installed before them") {
+        CountingObserver trace;
+        mmu.set_memory_observer(&trace);
+
+        REQUIRE(breakpoints.add("w c101", error) != 0);
+        REQUIRE(run_until_break(cpu, breakpoints) == 4);
+        REQUIRE(trace.writes == 1);
+        // 8 opcode and operand fetches plus the load from c100
+        REQUIRE(trace.reads == 9);
+
+        breakpoints.clear();
+        REQUIRE(mmu.get_memory_observer() == &trace);
+        mmu.write_byte(0xd000, 0);
+        REQUIRE(trace.writes == 2);
+    }
+
+    SECTION("bad specs are refused") {
+        REQUIRE(breakpoints.add("z c000", error) == 0);
+        REQUIRE(breakpoints.add("x c100-c000", error) == 0);
+        REQUIRE(breakpoints.add("x", error) == 0);
+        REQUIRE(breakpoints.add("x 0150 if pc", error) == 0);
+        REQUIRE_FALSE(breakpoints.is_armed());
+    }
+}
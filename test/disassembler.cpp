@@ -0,0 +1,105 @@
+/*
+ * test/disassembler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define DISASSEMBLER_TEST "[Disassembler]"
+
+#include "catch.hpp"
+#include "disassembler.hpp"
+#include "instruction.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+// Four banks of 0xff with:
+//
+//   0028: add a ; pop hl ; ld e,a ; ld d,0 ; add hl,de ; ld e,(hl) ;
+//         inc hl ; ld d,(hl) ; push de ; pop hl ; jp hl
+//   0100: nop ; jp $0150
+//   0150: ld a,2 ; ld ($2000),a ; call $4000 ; rst 28 ; dw $0160, $0170
+//   0160: halt ; jr $0160
+//   0170: ret
+//   bank 2, 4000: jp $0170
+std::vector<uint8_t> build_rom() {
+    std::vector<uint8_t> rom(4 * kRomBankSize, 0xff);
+    auto put = [&rom](size_t offset, std::initializer_list<uint8_t> bytes) {
+        for (uint8_t byte : bytes) {
+            rom[offset++] = byte;
+        }
+    };
+    put(0x0028, {0x87, 0xe1, 0x5f, 0x16, 0x00, 0x19, 0x5e, 0x23, 0x56, 0xd5, 0xe1, 0xe9});
+    put(0x0100, {0x00, 0xc3, 0x50, 0x01});
+    put(0x0150, {0x3e, 0x02, 0xea, 0x00, 0x20, 0xcd, 0x00, 0x40, 0xef, 0x60, 0x01, 0x70, 0x01});
+    put(0x0160, {0x76, 0x18, 0xfd});
+    put(0x0170, {0xc9});
+    put(2 * kRomBankSize, {0xc3, 0x70, 0x01});
+    return rom;
+}
+
+TEST_CASE("Instruction Names", DISASSEMBLER_TEST) {
+    REQUIRE(Instruction(0x0100, 0xc3, 0x50, 0x01).to_string() == "0100: jp $0150");
+    REQUIRE(Instruction(0, 0xcb, 0x7c, 0).to_assembly() == "bit 7,h");
+    REQUIRE(Instruction(0, 0xcb, 0x37, 0).to_assembly() == "swap a");
+    REQUIRE(Instruction(0, 0xcb, 0x86, 0).to_assembly() == "res 0,(hl)");
+    REQUIRE(Instruction::mnemonic(0xc3) == "jp $nn");
+    REQUIRE(Instruction::mnemonic(0x18) == "jr e");
+    REQUIRE(Instruction::length(0xcb) == 2);
+}
+
+TEST_CASE("Static Analysis", DISASSEMBLER_TEST) {
+    std::vector<uint8_t> rom = build_rom();
+    GBDisassembler disassembler(rom);
+    disassembler.analyze(4);
+    const GBCodeMap& map = disassembler.get_code_map();
+
+    REQUIRE(disassembler.get_bank_count() == 4);
+    REQUIRE((map.get(0, 0x0100) & CODE_ENTRY) != 0);
+    REQUIRE((map.get(0, 0x0150) & CODE_JUMP_TARGET) != 0);
+    REQUIRE(map.get(0, 0x0153) == CODE_OPERAND);
+
+    SECTION("far calls follow the bank written to the mbc") {
+        REQUIRE(map.get(2, 0x4000) == (CODE_OPCODE | CODE_CALL_TARGET));
+        REQUIRE(map.get(1, 0x4000) == 0);
+        REQUIRE(map.get(3, 0x4000) == 0);
+        REQUIRE((map.get(0, 0x0170) & CODE_OPCODE) != 0);
+    }
+
+    SECTION("rst jump tables are data pointing at code") {
+        REQUIRE(map.get(0, 0x0159) == CODE_TABLE);
+        REQUIRE(map.get(0, 0x015b) == CODE_TABLE);
+        REQUIRE(map.get(0, 0x015d) == 0);
+        REQUIRE(map.get(0, 0x0160) == (CODE_OPCODE | CODE_JUMP_TARGET));
+        REQUIRE((map.get(0, 0x0170) & CODE_JUMP_TARGET) != 0);
+    }
+
+    SECTION("the result doesn't depend on the thread count") {
+        GBDisassembler serial(rom);
+        serial.analyze(1);
+        REQUIRE(serial.get_code_map() == map);
+    }
+
+    SECTION("code maps are saved and loaded") {
+        const std::string filename = "disassembler_test.map";
+        REQUIRE(map.save(filename));
+        GBCodeMap loaded;
+        REQUIRE(loaded.load(filename));
+        REQUIRE(loaded == map);
+        std::remove(filename.c_str());
+    }
+
+    SECTION("listing and graph") {
+        std::ostringstream listing;
+        disassembler.write_disassembly(listing);
+        REQUIRE(listing.str().find("call $4000") != std::string::npos);
+        REQUIRE(listing.str().find("dw $0160") != std::string::npos);
+        REQUIRE(listing.str().find("F02_4000:") != std::string::npos);
+
+        std::ostringstream graph;
+        disassembler.write_cfg(graph);
+        REQUIRE(graph.str().find("\"00:0150\" -> \"02:4000\" [style=dashed]") != std::string::npos);
+        REQUIRE(graph.str().find("\"00:0160\" -> \"00:0160\"") != std::string::npos);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * test/frame_pacer.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define FRAME_PACER_TEST "[FramePacer]"
+
+#include "catch.hpp"
+#include "frame_pacer.hpp"
+
+#include <thread>
+
+using std::chrono::milliseconds;
+
+// how long a number of frames took, in milliseconds
+double time_frames(FramePacer& pacer, int frames) {
+    FramePacer::Clock::time_point start = FramePacer::Clock::now();
+    for (int i = 0; i < frames; i++) {
+        pacer.wait_frame();
+    }
+    return std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+}
+
+TEST_CASE("frame pacer runs at the lcd refresh rate", FRAME_PACER_TEST) {
+    SECTION("mode names") {
+        PacingMode mode = PACE_REALTIME;
+        REQUIRE(parse_pacing_mode("uncapped", mode));
+        REQUIRE(mode == PACE_UNCAPPED);
+        REQUIRE(parse_pacing_mode("vsync", mode));
+        REQUIRE(mode == PACE_VSYNC);
+        REQUIRE(parse_pacing_mode("realtime", mode));
+        REQUIRE(mode == PACE_REALTIME);
+        REQUIRE_FALSE(parse_pacing_mode("fast", mode));
+    }
+
+    SECTION("a frame is 70224 ticks long") {
+        FramePacer pacer;
+        double millis = std::chrono::duration<double, std::milli>(pacer.get_frame_duration()).count();
+        REQUIRE(millis == Approx(16.7427).epsilon(0.0001));
+    }
+
+    SECTION("realtime frames take their duration") {
+        FramePacer pacer;
+        double millis = time_frames(pacer, 6);
+        REQUIRE(millis >= 6 * 16.74);
+        REQUIRE(millis < 6 * 16.74 + 15);
+    }
+
+    SECTION("emulation time is part of the frame") {
+        FramePacer pacer;
+        pacer.wait_frame();
+        FramePacer::Clock::time_point start = FramePacer::Clock::now();
+        std::this_thread::sleep_for(milliseconds(10));
+        pacer.wait_frame();
+        double millis = std::chrono::duration<double, std::milli>(FramePacer::Clock::now() - start).count();
+        REQUIRE(millis >= 16.74);
+        REQUIRE(millis < 16.74 + 8);
+    }
+
+    SECTION("falling far behind doesn't burst to catch up") {
+        FramePacer pacer;
+        pacer.wait_frame();
+        std::this_thread::sleep_for(milliseconds(100));
+        pacer.wait_frame();
+        REQUIRE(pacer.get_late_frames() == 1);
+
+        double millis = time_frames(pacer, 2);
+        REQUIRE(millis >= 2 * 16.74 - 1);
+    }
+
+    SECTION("speed scales the frame duration") {
+        FramePacer pacer;
+        pacer.set_speed(4);
+        double millis = time_frames(pacer, 8);
+        REQUIRE(millis >= 2 * 16.74);
+        REQUIRE(millis < 2 * 16.74 + 15);
+
+        pacer.set_speed(0);
+        REQUIRE(time_frames(pacer, 100) < 10);
+    }
+
+    SECTION("achieved speed is measured") {
+        FramePacer pacer;
+        pacer.set_speed(2);
+        REQUIRE(pacer.get_measured_speed() == 0);
+        time_frames(pacer, 130);
+        REQUIRE(pacer.get_measured_speed() == Approx(2).epsilon(0.1));
+    }
+
+    SECTION("uncapped and paused don't wait") {
+        FramePacer pacer(PACE_UNCAPPED);
+        REQUIRE(time_frames(pacer, 100) < 10);
+
+        pacer.set_mode(PACE_REALTIME);
+        pacer.pause();
+        REQUIRE(time_frames(pacer, 100) < 10);
+        REQUIRE(pacer.get_frame_count() == 200);
+    }
+
+    SECTION("vsync waits for the display refresh") {
+        FramePacer pacer(PACE_VSYNC);
+        std::thread display([&pacer] {
+            std::this_thread::sleep_for(milliseconds(5));
+            pacer.vsync();
+        });
+        double millis = time_frames(pacer, 1);
+        display.join();
+        REQUIRE(millis >= 4);
+        REQUIRE(millis < 3 * 16.74);
+    }
+
+    SECTION("vsync falls back to the clock without refreshes") {
+        FramePacer pacer(PACE_VSYNC);
+        double millis = time_frames(pacer, 4);
+        REQUIRE(millis >= 4 * 16.74);
+        REQUIRE(millis < 5 * 16.74);
+    }
+}
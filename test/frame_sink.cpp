@@ -0,0 +1,42 @@
+/*
+ * test/frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define FRAME_SINK_TEST "[FrameSink]"
+
+#include "catch.hpp"
+#include "frame_sink.hpp"
+
+#include <vector>
+
+TEST_CASE("Changed Rows", FRAME_SINK_TEST) {
+    std::vector<uint8_t> previous(kScreenSize, 0);
+    std::vector<uint8_t> shades(kScreenSize, 0);
+
+    int first_row = -1;
+    int last_row = -1;
+
+    SECTION( "equal frames have no changed rows" ) {
+        REQUIRE_FALSE(find_changed_rows(previous.data(), shades.data(), first_row, last_row));
+        REQUIRE(first_row == -1);
+        REQUIRE(last_row == -1);
+    }
+
+    SECTION( "a single changed pixel marks its row" ) {
+        shades[42 * kScreenWidth + kScreenWidth - 1] = 3;
+        REQUIRE(find_changed_rows(previous.data(), shades.data(), first_row, last_row));
+        REQUIRE(first_row == 42);
+        REQUIRE(last_row == 42);
+    }
+
+    SECTION( "the range spans the first and last changed rows" ) {
+        shades[7 * kScreenWidth] = 1;
+        shades[(kScreenHeight - 1) * kScreenWidth + 80] = 2;
+        REQUIRE(find_changed_rows(previous.data(), shades.data(), first_row, last_row));
+        REQUIRE(first_row == 7);
+        REQUIRE(last_row == kScreenHeight - 1);
+    }
+}
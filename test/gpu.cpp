@@ -0,0 +1,158 @@
+/*
+ * test/gpu.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define GPU_TEST "[GBGPU]"
+
+#include "catch.hpp"
+#include "gpu.hpp"
+
+void run_frames(GBGPU& gpu, int frames) {
+    for (tick_t t = 0; t < frames * kTicksPerLcdFrame; t += 4) {
+        gpu.step(4);
+    }
+}
+
+TEST_CASE("GBGPU Frame Skip", GPU_TEST) {
+    GBMMU mmu;
+    GBGPU gpu(mmu);
+    MemoryFrameSink sink;
+    gpu.set_frame_sink(&sink);
+
+    mmu.hwio_lcdc = LCDC_FLAG_DISPLAY_ENABLE | LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE;
+    mmu.hwio_stat = READOAM;
+
+    SECTION( "render every frame" ) {
+        run_frames(gpu, 8);
+        REQUIRE(sink.get_frame_count() == 8);
+    }
+
+    SECTION( "render one of four frames" ) {
+        gpu.set_frame_skip(4);
+        run_frames(gpu, 8);
+        REQUIRE(sink.get_frame_count() == 2);
+    }
+
+    SECTION( "render only requested frames" ) {
+        gpu.set_frame_skip(0);
+        run_frames(gpu, 4);
+        REQUIRE(sink.get_frame_count() == 0);
+
+        gpu.request_frame();
+        run_frames(gpu, 4);
+        REQUIRE(sink.get_frame_count() == 1);
+    }
+
+    SECTION( "skipped frames keep vblank interrupts" ) {
+        gpu.set_frame_skip(0);
+        mmu.hwio_if = 0;
+        run_frames(gpu, 1);
+        REQUIRE((mmu.hwio_if & kInterruptionVBlank) != 0);
+    }
+}
+
+TEST_CASE("GBGPU Catch-up Matches Lockstep", GPU_TEST) {
+    GBMMU lockstep_mmu;
+    GBGPU lockstep_gpu(lockstep_mmu);
+
+    GBMMU catchup_mmu;
+    GBGPU catchup_gpu(catchup_mmu);
+
+    lockstep_mmu.hwio_stat = catchup_mmu.hwio_stat = READOAM;
+    lockstep_mmu.hwio_lyc = catchup_mmu.hwio_lyc = 0x40;
+
+    for (int i = 0; i < 100000; i++) {
+        tick_t t = (i % 3 == 0) ? 12 : 4;
+        lockstep_gpu.step(t);
+        catchup_gpu.tick(t);
+
+        if (i % 997 == 0) {
+            // reading LY through the mmu brings the catch-up PPU up to date
+            REQUIRE(catchup_mmu.read_byte(kAddrLY) == lockstep_mmu.hwio_ly);
+            REQUIRE(catchup_mmu.read_byte(kAddrSTAT) == lockstep_mmu.hwio_stat);
+        }
+
+        // interrupts are never late
+        REQUIRE(catchup_mmu.hwio_if == lockstep_mmu.hwio_if);
+        lockstep_mmu.hwio_if = catchup_mmu.hwio_if = 0;
+
+        if (i == 50000) {
+            // enabling STAT interrupts moves the next deadline
+            lockstep_mmu.write_byte(kAddrSTAT, kLcdInterruptHBlank);
+            catchup_mmu.write_byte(kAddrSTAT, kLcdInterruptHBlank);
+        }
+    }
+}
+
+TEST_CASE("GBGPU Static Screen Reuse", GPU_TEST) {
+    GBMMU mmu;
+    GBGPU gpu(mmu);
+    MemoryFrameSink sink;
+    gpu.set_frame_sink(&sink);
+
+    mmu.hwio_lcdc = LCDC_FLAG_DISPLAY_ENABLE | LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE;
+    mmu.hwio_stat = READOAM;
+
+    run_frames(gpu, 4);
+    REQUIRE(sink.get_frame_count() == 4);
+    REQUIRE(gpu.get_reused_frames() == 3);
+
+    SECTION( "writing the same values keeps the frame" ) {
+        mmu.write_byte(0x8000, mmu.read_byte(0x8000));
+        mmu.write_byte(kAddrSCY, mmu.hwio_scy);
+        run_frames(gpu, 1);
+        REQUIRE(gpu.get_reused_frames() == 4);
+    }
+
+    SECTION( "vram changes render a new frame" ) {
+        // low bits of the first line of tile 0 (signed tile data at 0x9000)
+        mmu.hwio_bgp = 0xe4;
+        mmu.write_byte(0x9000, 0xff);
+        run_frames(gpu, 2);
+        REQUIRE(gpu.get_reused_frames() == 4);
+        REQUIRE(sink.get_frame()[0] == 2);
+    }
+
+    SECTION( "scroll changes render a new frame" ) {
+        mmu.write_byte(kAddrSCY, 1);
+        run_frames(gpu, 1);
+        REQUIRE(gpu.get_reused_frames() == 3);
+    }
+
+    SECTION( "scroll written in vblank shows in the next frame" ) {
+        // only the first line of tile 0 is set, scrolling by one line
+        // moves it from the top of the screen to line 7
+        mmu.hwio_bgp = 0xe4;
+        mmu.write_byte(0x9000, 0xff);
+        run_frames(gpu, 1);
+        REQUIRE(sink.get_frame()[0] == 2);
+        REQUIRE(sink.get_frame()[7 * 160] == 0);
+
+        for (int t = 0; t < 145 * 456; t += 4) {
+            gpu.step(4);
+        }
+        REQUIRE((mmu.hwio_stat & 0x3) == VBLANK);
+        mmu.write_byte(kAddrSCY, 1);
+        run_frames(gpu, 1);
+        REQUIRE(sink.get_frame()[0] == 0);
+        REQUIRE(sink.get_frame()[7 * 160] == 2);
+
+        run_frames(gpu, 4);
+        REQUIRE(sink.get_frame()[0] == 0);
+        REQUIRE(sink.get_frame()[7 * 160] == 2);
+    }
+
+    SECTION( "mid-frame changes also render the following frame" ) {
+        for (int t = 0; t < 72 * 456; t += 4) {
+            gpu.step(4);
+        }
+        mmu.write_byte(kAddrSCY, 1);
+        run_frames(gpu, 2);
+        REQUIRE(gpu.get_reused_frames() == 3);
+        run_frames(gpu, 1);
+        REQUIRE(gpu.get_reused_frames() == 4);
+    }
+}
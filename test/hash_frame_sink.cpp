@@ -0,0 +1,67 @@
+/*
+ * test/hash_frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define HASH_TEST "[HashFrameSink]"
+
+#include "catch.hpp"
+#include "hash_frame_sink.hpp"
+#include "utils.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+TEST_CASE("Frame Hashing", HASH_TEST) {
+    const std::string filename = "hash_test.hash";
+
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+    MemoryFrameSink memory;
+    std::vector<uint8_t> shades(kScreenSize, 1);
+
+    {
+        HashFrameSink sink(filename, &cpu, &memory);
+        REQUIRE(sink.is_open());
+
+        sink.present(shades.data(), 0);
+        sink.write_frame();
+        uint64_t first = sink.get_last_hash();
+        REQUIRE(first == hash64(shades.data(), shades.size()));
+
+        // a single pixel changes the hash, and the frame is passed on
+        shades[kScreenSize - 1] = 2;
+        sink.present(shades.data(), 0);
+        REQUIRE(sink.get_last_hash() != first);
+        REQUIRE(memory.get_frame_count() == 2);
+        REQUIRE(memory.get_frame()[kScreenSize - 1] == 2);
+        sink.write_frame();
+
+        // emulated frames without a presented one still get a line, and
+        // the cpu state is part of it
+        cpu.reg.pc = 0x150;
+        sink.write_frame();
+        REQUIRE(sink.get_frames_written() == 3);
+        REQUIRE(sink.get_frames_presented() == 2);
+    }
+
+    std::ifstream file(filename);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    REQUIRE(lines.size() == 3);
+    REQUIRE(lines[0].size() == 6 + 4 * 17);
+    REQUIRE(lines[0].compare(0, 7, "000000 ") == 0);
+    REQUIRE(lines[2].compare(0, 7, "000002 ") == 0);
+
+    // same frame and memory, only the program counter moved
+    REQUIRE(lines[1].substr(7, 3 * 17) == lines[2].substr(7, 3 * 17));
+    REQUIRE(lines[1].substr(7 + 3 * 17) != lines[2].substr(7 + 3 * 17));
+
+    std::remove(filename.c_str());
+}
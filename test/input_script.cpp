@@ -0,0 +1,45 @@
+/*
+ * test/input_script.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define INPUT_SCRIPT_TEST "[GBInputScript]"
+
+#include "catch.hpp"
+#include "input_script.hpp"
+
+#include <sstream>
+
+TEST_CASE("Input Script Replay", INPUT_SCRIPT_TEST) {
+    GBInputScript script;
+    std::string error;
+
+    std::stringstream input(
+        "# frame keys\n"
+        "\n"
+        "10 start\n"
+        "12 -        # release\n"
+        "20 a+left\n");
+    REQUIRE(script.parse(input, error));
+
+    REQUIRE(script.state_at(0) == kJoypadReleased);
+    REQUIRE(script.state_at(10) == static_cast<uint8_t>(~JOYPAD_START));
+    REQUIRE(script.state_at(11) == static_cast<uint8_t>(~JOYPAD_START));
+    REQUIRE(script.state_at(12) == kJoypadReleased);
+    REQUIRE(script.state_at(25) == static_cast<uint8_t>(~(JOYPAD_A | JOYPAD_LEFT)));
+}
+
+TEST_CASE("Input Script Errors", INPUT_SCRIPT_TEST) {
+    GBInputScript script;
+    std::string error;
+
+    std::stringstream unknown_key("10 turbo\n");
+    REQUIRE_FALSE(script.parse(unknown_key, error));
+    REQUIRE(error == "line 1: unknown key turbo");
+
+    std::stringstream out_of_order("10 a\n5 -\n");
+    REQUIRE_FALSE(script.parse(out_of_order, error));
+    REQUIRE(error == "line 2: frames out of order");
+}
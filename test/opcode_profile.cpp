@@ -0,0 +1,45 @@
+/*
+ * test/opcode_profile.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define OPCODE_PROFILE_TEST "[OpcodeProfile]"
+
+#include "catch.hpp"
+#include "cpu.hpp"
+
+// only an instrumented build has something to test
+#ifdef GB_OPCODE_PROFILE
+
+#include <sstream>
+
+TEST_CASE("Opcode Mix", OPCODE_PROFILE_TEST) {
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+
+    // nop ; nop ; swap a
+    mmu.write_byte(0xc000, 0x00);
+    mmu.write_byte(0xc001, 0x00);
+    mmu.write_byte(0xc002, 0xcb);
+    mmu.write_byte(0xc003, 0x37);
+    cpu.reg.pc = 0xc000;
+
+    OpcodeProfile& profile = OpcodeProfile::global();
+    profile.clear();
+    for (int i = 0; i < 3; i++) {
+        cpu.step();
+    }
+
+    REQUIRE(profile.get_count(false, 0x00) == 2);
+    REQUIRE(profile.get_count(false, 0xcb) == 1);
+    REQUIRE(profile.get_count(true, 0x37) == 1);
+
+    std::ostringstream report;
+    profile.write_report(report);
+    REQUIRE(report.str().find("swap a") != std::string::npos);
+    profile.clear();
+}
+
+#endif
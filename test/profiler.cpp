@@ -0,0 +1,97 @@
+/*
+ * test/profiler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define PROFILER_TEST "[Profiler]"
+
+#include "catch.hpp"
+#include "profiler.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// c000: call c010 ; jr -5 back to c000
+// c010: nop ; ret
+// c020: reti
+void load_calls(GBMMU& mmu, GBCPU& cpu) {
+    const uint8_t main[] = {0xcd, 0x10, 0xc0, 0x18, 0xfb};
+    for (size_t i = 0; i < sizeof(main); i++) {
+        mmu.write_byte(0xc000 + i, main[i]);
+    }
+    mmu.write_byte(0xc010, 0x00);
+    mmu.write_byte(0xc011, 0xc9);
+    mmu.write_byte(0xc020, 0xd9);
+    cpu.reg.pc = 0xc000;
+    cpu.reg.sp = 0xdff0;
+}
+
+TEST_CASE("Symbol Files", PROFILER_TEST) {
+    const std::string filename = "profiler_test.sym";
+    {
+        std::ofstream file(filename);
+        file << "; File generated by rgblink\n";
+        file << "00:0150 Start\n";
+        file << "02:4000 BankedSub ; comment\n";
+        file << "00:c010 Sub\n";
+    }
+
+    GBSymbols symbols;
+    REQUIRE(symbols.load(filename));
+    std::remove(filename.c_str());
+
+    REQUIRE(symbols.size() == 3);
+    REQUIRE(symbols.exact(0, 0x0150) == "Start");
+    REQUIRE(symbols.describe(0, 0x0153) == "Start+0x3");
+    REQUIRE(symbols.describe(2, 0x4000) == "BankedSub");
+    REQUIRE(symbols.describe(3, 0x4000) == "03:4000");
+    REQUIRE(symbols.describe(5, 0xc010) == "Sub");
+}
+
+TEST_CASE("Guest Profiling", PROFILER_TEST) {
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+    load_calls(mmu, cpu);
+    GBProfiler profiler(cpu);
+
+    uint64_t cycles = 0;
+    for (int i = 0; i < 4 * 4; i++) {
+        cycles += profiler.step();
+    }
+
+    REQUIRE(profiler.get_total_cycles() == cycles);
+    REQUIRE(profiler.get_depth() == 0);
+    REQUIRE(profiler.get_cycles(0, 0xc010) == 4 * 4);
+    REQUIRE(profiler.get_cycles(0, 0xc000) > 0);
+
+    SECTION("calls are folded by stack, with symbol names") {
+        GBSymbols symbols;
+        symbols.add(0, 0xc010, "Sub");
+
+        std::ostringstream folded;
+        profiler.write_folded(folded, symbols);
+        std::string expected_sub = "root;Sub " + std::to_string(
+            profiler.get_cycles(0, 0xc010) + profiler.get_cycles(0, 0xc011));
+        REQUIRE(folded.str().find(expected_sub + "\n") != std::string::npos);
+        REQUIRE(folded.str().compare(0, 5, "root ") == 0);
+    }
+
+    SECTION("interrupts open a frame that reti closes") {
+        // as if service_interrupts() pushed c000 and jumped to c020
+        tick_t t = cpu.push_rr(cpu.reg.pc);
+        cpu.reg.pc = 0xc020;
+        profiler.interrupt(t);
+        REQUIRE(profiler.get_depth() == 1);
+
+        profiler.step();
+        REQUIRE(cpu.reg.pc == 0xc000);
+        REQUIRE(profiler.get_depth() == 0);
+
+        std::ostringstream folded;
+        profiler.write_folded(folded, GBSymbols());
+        REQUIRE(folded.str().find("root;00:c020 ") != std::string::npos);
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * test/recorder_frame_sink.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define RECORDER_TEST "[RecorderFrameSink]"
+
+#include "catch.hpp"
+#include "recorder_frame_sink.hpp"
+#include "clock.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+TEST_CASE("Record Format From Extension", RECORDER_TEST) {
+    RecordFormat format;
+
+    REQUIRE(parse_record_format("run.y4m", format));
+    REQUIRE(format == RECORD_Y4M);
+    REQUIRE(parse_record_format("shots/run.png", format));
+    REQUIRE(format == RECORD_PNG);
+    REQUIRE_FALSE(parse_record_format("run.ppm", format));
+}
+
+TEST_CASE("Record Raw Frames", RECORDER_TEST) {
+    const std::string filename = "recorder_test.raw";
+
+    std::vector<uint8_t> first(kScreenSize, 0);
+    std::vector<uint8_t> second(kScreenSize, 3);
+
+    {
+        RecorderFrameSink recorder(filename, RECORD_RAW);
+        REQUIRE(recorder.is_open());
+
+        // more frames than the queue holds, duplicates in between, the
+        // first one completed some time after power on
+        uint64_t timestamp = 1000;
+        for (int i = 0; i < 100; i++) {
+            recorder.present(first.data(), timestamp);
+            recorder.present(first.data(), timestamp + kTicksPerLcdFrame);
+            recorder.present(second.data(), timestamp + 2 * kTicksPerLcdFrame);
+            timestamp += 3 * kTicksPerLcdFrame;
+        }
+        recorder.close();
+
+        REQUIRE(recorder.get_frames_received() == 300);
+        REQUIRE(recorder.get_frames_written() == 200);
+    }
+
+    std::ifstream raw(filename, std::ifstream::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+    REQUIRE(data.size() == 200 * kScreenSize);
+    REQUIRE(data[0] == 0);
+    REQUIRE(data[kScreenSize] == 3);
+
+    std::ifstream timecodes(filename + ".timecodes");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(timecodes, line)) {
+        lines.push_back(line);
+    }
+    REQUIRE(lines.size() == 201);
+    REQUIRE(lines[0] == "# timecode format v2");
+    REQUIRE(lines[1] == "0.000");
+    REQUIRE(lines[2] == "33.485"); // frame 2, 2 * 70224 / 4194304 s
+
+    std::remove(filename.c_str());
+    std::remove((filename + ".timecodes").c_str());
+}
+
+TEST_CASE("Record Timecodes Follow Emulated Time", RECORDER_TEST) {
+    const std::string filename = "recorder_gap_test.raw";
+
+    std::vector<uint8_t> first(kScreenSize, 0);
+    std::vector<uint8_t> second(kScreenSize, 3);
+
+    {
+        // frames skipped or not presented while the LCD was off leave a
+        // gap between the timestamps of the presented ones
+        RecorderFrameSink recorder(filename, RECORD_RAW);
+        REQUIRE(recorder.is_open());
+        recorder.present(first.data(), 5 * kTicksPerLcdFrame);
+        recorder.present(second.data(), 15 * kTicksPerLcdFrame);
+        recorder.present(first.data(), 19 * kTicksPerLcdFrame);
+        recorder.close();
+    }
+
+    std::ifstream timecodes(filename + ".timecodes");
+    std::string line;
+    std::vector<std::string> lines;
+    while (std::getline(timecodes, line)) {
+        lines.push_back(line);
+    }
+    REQUIRE(lines.size() == 4);
+    REQUIRE(lines[1] == "0.000");
+    REQUIRE(lines[2] == "167.427"); // 10 * 70224 / 4194304 s
+    REQUIRE(lines[3] == "234.398"); // 14 frames
+
+    std::remove(filename.c_str());
+    std::remove((filename + ".timecodes").c_str());
+}
+
+TEST_CASE("Record Y4m Frames", RECORDER_TEST) {
+    const std::string filename = "recorder_test.y4m";
+
+    std::vector<uint8_t> shades(kScreenSize, 0);
+    shades[1] = 3;
+
+    {
+        RecorderFrameSink recorder(filename, RECORD_Y4M);
+        REQUIRE(recorder.is_open());
+        recorder.present(shades.data(), 0);
+        recorder.close();
+    }
+
+    std::ifstream y4m(filename, std::ifstream::binary);
+    std::string header;
+    std::getline(y4m, header);
+    REQUIRE(header == "YUV4MPEG2 W160 H144 F4194304:70224 Ip A1:1 C444 XCOLORRANGE=FULL");
+
+    std::string frame;
+    std::getline(y4m, frame);
+    REQUIRE(frame == "FRAME");
+
+    // full range luma, the lightest and darkest shades of the palette
+    std::vector<uint8_t> luma(kScreenSize);
+    y4m.read(reinterpret_cast<char*>(luma.data()), luma.size());
+    REQUIRE(luma[0] == 158);
+    REQUIRE(luma[1] == 39);
+
+    std::remove(filename.c_str());
+    std::remove((filename + ".timecodes").c_str());
+}
+
+TEST_CASE("Encode Indexed Png", RECORDER_TEST) {
+    std::vector<uint8_t> shades(kScreenSize, 0);
+    shades[0] = 3;
+
+    auto png = encode_png(shades.data());
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    REQUIRE(std::equal(signature, signature + 8, png.begin()));
+
+    // IHDR: 160x144, 2 bit, indexed
+    REQUIRE(std::string(png.begin() + 12, png.begin() + 16) == "IHDR");
+    REQUIRE(png[18] == 0);
+    REQUIRE(png[19] == kScreenWidth);
+    REQUIRE(png[23] == kScreenHeight);
+    REQUIRE(png[24] == 2);
+    REQUIRE(png[25] == 3);
+
+    // ends with an empty IEND chunk and its fixed crc
+    const uint8_t iend[] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xae, 0x42, 0x60, 0x82};
+    REQUIRE(std::equal(iend, iend + 12, png.end() - 12));
+}
@@ -0,0 +1,39 @@
+/*
+ * test/ring_buffer.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define RING_BUFFER_TEST "[RingBuffer]"
+
+#include "catch.hpp"
+#include "ring_buffer.hpp"
+
+TEST_CASE("Ring Buffer History", RING_BUFFER_TEST) {
+    RingBuffer<int, 4> ring;
+    REQUIRE(ring.size() == 0);
+
+    ring.push(1);
+    ring.push(2);
+    REQUIRE(ring.size() == 2);
+    REQUIRE(ring[0] == 1);
+    REQUIRE(ring[1] == 2);
+
+    SECTION( "keeps the newest entries once full" ) {
+        for (int i = 3; i <= 10; i++) {
+            ring.push(i);
+        }
+        REQUIRE(ring.size() == 4);
+        REQUIRE(ring.total() == 10);
+        REQUIRE(ring[0] == 7);
+        REQUIRE(ring[3] == 10);
+    }
+
+    SECTION( "clear forgets everything" ) {
+        ring.clear();
+        REQUIRE(ring.size() == 0);
+        ring.push(5);
+        REQUIRE(ring[0] == 5);
+    }
+}
@@ -0,0 +1,210 @@
+/*
+ * test/save_state.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define SAVE_STATE_TEST "[SaveState]"
+
+#include "catch.hpp"
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// c000: inc a ; ld (d000),a ; ldh (scx),a ; ld (hl),a ; inc l ; jr c000
+// with hl in the background map, so every pass changes vram, wram and a
+// raster register
+struct StateMachine {
+    GBMMU mmu;
+    GBCPU cpu;
+    GBGPU gpu;
+    MemoryFrameSink sink;
+
+    StateMachine() : cpu(mmu), gpu(mmu) {
+        gpu.set_frame_sink(&sink);
+        cpu.unload_bios();
+
+        const uint8_t program[] = {0x3c, 0xea, 0x00, 0xd0, 0xe0, 0x43, 0x77, 0x2c, 0x18, 0xf6};
+        for (size_t i = 0; i < sizeof(program); i++) {
+            mmu.write_byte(0xc000 + i, program[i]);
+        }
+        cpu.reg.pc = 0xc000;
+        cpu.reg.hl = 0x9800;
+        mmu.hwio_lcdc = LCDC_FLAG_DISPLAY_ENABLE | LCDC_FLAG_BACKGROUND_DISPLAY_ENABLE;
+        mmu.hwio_bgp = 0xe4;
+    }
+
+    void run(int steps) {
+        for (int i = 0; i < steps; i++) {
+            tick_t t = cpu.step();
+            gpu.tick(t);
+            mmu.step(t);
+
+            t = cpu.service_interrupts();
+            if (t) {
+                gpu.tick(t);
+                mmu.step(t);
+            }
+        }
+    }
+};
+
+TEST_CASE("save states restore the whole machine", SAVE_STATE_TEST) {
+    StateMachine machine;
+    machine.run(20000);
+
+    std::vector<uint8_t> state;
+    save_state(machine.cpu, machine.gpu, state);
+
+    SECTION("running on from a restored state repeats the same frames") {
+        uint64_t saved_frames = machine.sink.get_frame_count();
+        machine.run(50000);
+        std::vector<uint8_t> frame = machine.sink.get_frame();
+        uint64_t frames = machine.sink.get_frame_count() - saved_frames;
+        uint16_t pc = machine.cpu.reg.pc;
+        uint8_t counter = machine.mmu.read_byte(0xd000);
+        REQUIRE(frames > 0);
+
+        std::string error;
+        REQUIRE(load_state(machine.cpu, machine.gpu, state.data(), state.size(), error));
+        machine.run(50000);
+
+        REQUIRE(machine.sink.get_frame_count() == saved_frames + 2 * frames);
+        REQUIRE(machine.sink.get_frame() == frame);
+        REQUIRE(machine.cpu.reg.pc == pc);
+        REQUIRE(machine.mmu.read_byte(0xd000) == counter);
+    }
+
+    SECTION("a restored machine saves the same bytes") {
+        StateMachine other;
+        std::string error;
+        REQUIRE(load_state(other.cpu, other.gpu, state.data(), state.size(), error));
+
+        std::vector<uint8_t> again;
+        save_state(other.cpu, other.gpu, again);
+        REQUIRE(again == state);
+    }
+
+    SECTION("bad states are refused and leave the machine as it was") {
+        machine.run(1000);
+        std::vector<uint8_t> before;
+        save_state(machine.cpu, machine.gpu, before);
+
+        std::string error;
+        std::vector<uint8_t> bad = state;
+        bad[0] = 'X';
+        REQUIRE_FALSE(load_state(machine.cpu, machine.gpu, bad.data(), bad.size(), error));
+        REQUIRE(error == "not a save state");
+
+        bad = state;
+        bad[8] = kSaveStateVersion + 1;
+        REQUIRE_FALSE(load_state(machine.cpu, machine.gpu, bad.data(), bad.size(), error));
+
+        REQUIRE_FALSE(load_state(machine.cpu, machine.gpu, state.data(), state.size() - 1, error));
+
+        // the cpu and mmu sections are applied before the gpu one fails
+        bad = state;
+        const char tag[] = "GPU ";
+        auto gpu_section = std::search(bad.begin(), bad.end(), tag, tag + 4);
+        REQUIRE(gpu_section != bad.end());
+        *gpu_section = 'X';
+        REQUIRE_FALSE(load_state(machine.cpu, machine.gpu, bad.data(), bad.size(), error));
+        REQUIRE(error == "save state section GPU  not found");
+
+        std::vector<uint8_t> after;
+        save_state(machine.cpu, machine.gpu, after);
+        REQUIRE(after == before);
+    }
+
+    SECTION("states go to files and back") {
+        const char* filename = "test_save_state.gbs";
+        REQUIRE(save_state_file(filename, machine.cpu, machine.gpu));
+
+        StateMachine other;
+        std::string error;
+        REQUIRE(load_state_file(filename, other.cpu, other.gpu, error));
+        std::remove(filename);
+
+        std::vector<uint8_t> loaded;
+        save_state(other.cpu, other.gpu, loaded);
+        REQUIRE(loaded == state);
+
+        REQUIRE_FALSE(load_state_file(filename, other.cpu, other.gpu, error));
+    }
+
+    SECTION("saving and loading take well under a millisecond") {
+        const int kRounds = 100;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRounds; i++) {
+            save_state(machine.cpu, machine.gpu, state);
+            REQUIRE(load_state(machine.cpu, machine.gpu, state.data(), state.size(), error));
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(elapsed.count() / kRounds < 1.0);
+    }
+}
+
+TEST_CASE("save states keep the bank controller registers", SAVE_STATE_TEST) {
+    MBC1 mbc(32, 4);
+    mbc.write(0x0000, 0x0a);
+    mbc.write(0x2000, 5);
+
+    std::vector<uint8_t> buffer;
+    GBStateWriter writer(buffer);
+    mbc.save_state(writer);
+
+    MBC1 restored(32, 4);
+    GBStateReader reader(buffer.data(), buffer.size());
+    restored.load_state(reader);
+    REQUIRE(reader.is_ok());
+    REQUIRE(reader.get_remaining() == 0);
+    REQUIRE(restored.get_rom_bank() == 5);
+    REQUIRE(restored.is_ram_enabled());
+
+    MBC1 smaller(4, 0);
+    GBStateReader other_reader(buffer.data(), buffer.size());
+    smaller.load_state(other_reader);
+    REQUIRE_FALSE(other_reader.is_ok());
+}
+
+// rom bank, ram bank, ram enabled and banking mode as MBC1 saves them
+static std::vector<uint8_t> mbc1_state(uint32_t rom_bank, uint32_t ram_bank, bool ram_banking_mode) {
+    std::vector<uint8_t> buffer;
+    GBStateWriter writer(buffer);
+    writer.write(rom_bank);
+    writer.write(ram_bank);
+    writer.write(true);
+    writer.write(ram_banking_mode);
+    return buffer;
+}
+
+static bool loads(MBC& mbc, const std::vector<uint8_t>& buffer) {
+    GBStateReader reader(buffer.data(), buffer.size());
+    mbc.load_state(reader);
+    return reader.is_ok();
+}
+
+TEST_CASE("save states refuse banks past the last one", SAVE_STATE_TEST) {
+    MBC1 mbc(32, 4);
+
+    REQUIRE(loads(mbc, mbc1_state(31, 0, false)));
+    REQUIRE_FALSE(loads(mbc, mbc1_state(32, 0, false)));
+
+    REQUIRE(loads(mbc, mbc1_state(1, 3, true)));
+    REQUIRE_FALSE(loads(mbc, mbc1_state(1, 4, true)));
+
+    // the upper rom bank bits take the bank past the 32 the rom has
+    REQUIRE_FALSE(loads(mbc, mbc1_state(1, 1, false)));
+
+    MBC plain(8, 2);
+    std::vector<uint8_t> buffer;
+    GBStateWriter writer(buffer);
+    writer.write(static_cast<uint32_t>(1));
+    writer.write(static_cast<uint32_t>(2));
+    writer.write(true);
+    REQUIRE_FALSE(loads(plain, buffer));
+}
@@ -0,0 +1,124 @@
+/*
+ * test/scaler.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define SCALER_TEST "[Scaler]"
+
+#include "catch.hpp"
+#include "scaler.hpp"
+
+#include <vector>
+
+std::vector<uint32_t> make_test_frame() {
+    std::vector<uint32_t> frame(kScreenSize);
+    uint32_t seed = 0x1234567;
+    for (auto& pixel : frame) {
+        seed = seed * 1103515245 + 12345;
+        // few colors, so most neighbours match and the edge rules kick in
+        pixel = kShadePalette[(seed >> 16) & 0x3];
+    }
+    return frame;
+}
+
+uint32_t pixel_at(const std::vector<uint32_t>& frame, int x, int y) {
+    x = std::min(std::max(x, 0), kScreenWidth - 1);
+    y = std::min(std::max(y, 0), kScreenHeight - 1);
+    return frame[y * kScreenWidth + x];
+}
+
+TEST_CASE("Scale Filter Names", SCALER_TEST) {
+    ScaleFilter filter;
+    int factor;
+
+    REQUIRE(parse_scale_filter("3x", filter, factor));
+    REQUIRE(filter == SCALE_NEAREST);
+    REQUIRE(factor == 3);
+
+    REQUIRE(parse_scale_filter("scale2x", filter, factor));
+    REQUIRE(filter == SCALE_2X);
+    REQUIRE(factor == 2);
+
+    REQUIRE_FALSE(parse_scale_filter("9x", filter, factor));
+    REQUIRE_FALSE(parse_scale_filter("hq2x", filter, factor));
+}
+
+TEST_CASE("Nearest Scaling", SCALER_TEST) {
+    auto frame = make_test_frame();
+
+    for (int factor = 1; factor <= 4; factor++) {
+        Scaler scaler(SCALE_NEAREST, factor);
+        int width = scaler.get_output_width();
+        std::vector<uint32_t> output(width * scaler.get_output_height());
+        scaler.scale(frame.data(), output.data(), width * sizeof(uint32_t));
+
+        bool same = true;
+        for (int y = 0; y < scaler.get_output_height(); y++) {
+            for (int x = 0; x < width; x++) {
+                same = same && output[y * width + x] == pixel_at(frame, x / factor, y / factor);
+            }
+        }
+        REQUIRE(same);
+    }
+}
+
+TEST_CASE("Scale2x Scaling", SCALER_TEST) {
+    auto frame = make_test_frame();
+
+    Scaler scaler(SCALE_2X);
+    REQUIRE(scaler.get_factor() == 2);
+
+    int width = scaler.get_output_width();
+    std::vector<uint32_t> output(width * scaler.get_output_height());
+    scaler.scale(frame.data(), output.data(), width * sizeof(uint32_t));
+
+    bool same = true;
+    for (int y = 0; y < kScreenHeight; y++) {
+        for (int x = 0; x < kScreenWidth; x++) {
+            uint32_t B = pixel_at(frame, x, y - 1);
+            uint32_t D = pixel_at(frame, x - 1, y);
+            uint32_t E = pixel_at(frame, x, y);
+            uint32_t F = pixel_at(frame, x + 1, y);
+            uint32_t H = pixel_at(frame, x, y + 1);
+
+            bool edge = B != H && D != F;
+            const uint32_t* out0 = &output[(y * 2) * width + x * 2];
+            const uint32_t* out1 = out0 + width;
+
+            same = same && out0[0] == (edge && D == B ? D : E);
+            same = same && out0[1] == (edge && B == F ? F : E);
+            same = same && out1[0] == (edge && D == H ? D : E);
+            same = same && out1[1] == (edge && H == F ? F : E);
+        }
+    }
+    REQUIRE(same);
+}
+
+TEST_CASE("Scaling Row Bands", SCALER_TEST) {
+    auto frame = make_test_frame();
+    ScaleFilter filters[] = {SCALE_NEAREST, SCALE_2X, SCALE_3X};
+
+    for (ScaleFilter filter : filters) {
+        Scaler single(filter, 4, 1);
+        Scaler banded(filter, 4, 3);
+
+        int width = single.get_output_width();
+        int pitch = width * sizeof(uint32_t);
+        std::vector<uint32_t> expected(width * single.get_output_height());
+        std::vector<uint32_t> output(width * single.get_output_height(), 0);
+
+        single.scale(frame.data(), expected.data(), pitch);
+        banded.scale(frame.data(), output.data(), pitch);
+        REQUIRE(output == expected);
+
+        // rescaling only some rows writes the same output for them
+        std::fill(output.begin(), output.end(), 0);
+        int factor = single.get_factor();
+        banded.scale(frame.data(), output.data() + 10 * factor * width, pitch, 10, 20);
+        REQUIRE(std::equal(output.begin() + 10 * factor * width,
+                           output.begin() + 21 * factor * width,
+                           expected.begin() + 10 * factor * width));
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * test/speed_control.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define SPEED_CONTROL_TEST "[SpeedControl]"
+
+#include "catch.hpp"
+#include "speed_control.hpp"
+
+TEST_CASE("speed control selects multipliers and turbo", SPEED_CONTROL_TEST) {
+    SECTION("speeds parse with or without the x") {
+        double speed = 1;
+        REQUIRE(parse_speed("4x", speed));
+        REQUIRE(speed == 4);
+        REQUIRE(parse_speed("0.5", speed));
+        REQUIRE(speed == 0.5);
+        REQUIRE(parse_speed("unlimited", speed));
+        REQUIRE(speed == kUnlimitedSpeed);
+        REQUIRE_FALSE(parse_speed("0x", speed));
+        REQUIRE_FALSE(parse_speed("-2", speed));
+        REQUIRE_FALSE(parse_speed("fast", speed));
+        REQUIRE_FALSE(parse_speed("x", speed));
+
+        REQUIRE(format_speed(0.25) == "0.25x");
+        REQUIRE(format_speed(8) == "8x");
+        REQUIRE(format_speed(kUnlimitedSpeed) == "unlimited");
+    }
+
+    SECTION("steps go from slow motion to unlimited") {
+        SpeedControl control;
+        control.faster();
+        REQUIRE(control.get_speed() == 2);
+        control.faster();
+        control.faster();
+        REQUIRE(control.get_speed() == 8);
+        control.faster();
+        REQUIRE(control.get_speed() == kUnlimitedSpeed);
+        control.faster();
+        REQUIRE(control.get_speed() == kUnlimitedSpeed);
+
+        control.slower();
+        REQUIRE(control.get_speed() == 8);
+
+        control.set_speed(1);
+        control.slower();
+        control.slower();
+        control.slower();
+        REQUIRE(control.get_speed() == 0.25);
+    }
+
+    SECTION("speeds between steps move to their neighbours") {
+        SpeedControl control(3);
+        control.faster();
+        REQUIRE(control.get_speed() == 4);
+
+        control.set_speed(3);
+        control.slower();
+        REQUIRE(control.get_speed() == 2);
+
+        control.set_speed(20);
+        control.faster();
+        REQUIRE(control.get_speed() == kUnlimitedSpeed);
+    }
+
+    SECTION("turbo overrides the selected speed while on") {
+        SpeedControl control(0.5, 4);
+        control.hold_turbo(true);
+        REQUIRE(control.is_turbo());
+        REQUIRE(control.get_speed() == 4);
+        control.hold_turbo(false);
+        REQUIRE(control.get_speed() == 0.5);
+
+        control.toggle_turbo();
+        REQUIRE(control.get_speed() == 4);
+        control.toggle_turbo();
+        REQUIRE_FALSE(control.is_turbo());
+    }
+
+    SECTION("frame skip keeps about one rendered frame per refresh") {
+        SpeedControl control;
+        REQUIRE(control.get_frame_skip(1) == 1);
+        control.set_speed(0.5);
+        REQUIRE(control.get_frame_skip(0.5) == 1);
+        control.set_speed(4);
+        REQUIRE(control.get_frame_skip(4) == 4);
+        control.set_speed(kUnlimitedSpeed);
+        REQUIRE(control.get_frame_skip(0) == 1);
+        REQUIRE(control.get_frame_skip(12.3) == 12);
+    }
+}
@@ -0,0 +1,129 @@
+/*
+ * test/trace.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#define TRACE_TEST "[Trace]"
+
+#include "catch.hpp"
+#include "trace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+std::vector<TraceEntry> read_trace(const std::string& filename, TraceHeader& header) {
+    std::vector<TraceEntry> entries;
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        return entries;
+    }
+
+    if (std::fread(&header, sizeof(header), 1, file) == 1) {
+        TraceEntry entry;
+        while (std::fread(&entry, kTraceEntrySize, 1, file) == 1) {
+            entries.push_back(entry);
+        }
+    }
+    std::fclose(file);
+    return entries;
+}
+
+// nop, ld a,(0xc100), jr -6 back to the first nop
+void load_loop(GBMMU& mmu, GBCPU& cpu) {
+    const uint8_t program[] = {0x00, 0xfa, 0x00, 0xc1, 0x18, 0xfa};
+    for (size_t i = 0; i < sizeof(program); i++) {
+        mmu.write_byte(0xc000 + i, program[i]);
+    }
+    mmu.write_byte(0xc100, 0x42);
+    cpu.reg.pc = 0xc000;
+}
+
+std::vector<TraceEntry> trace_loop(TraceMode mode, size_t steps, TraceHeader& header) {
+    const std::string filename = "trace_test.trace";
+
+    GBMMU mmu;
+    GBCPU cpu(mmu);
+    load_loop(mmu, cpu);
+
+    {
+        GBTraceRecorder trace(filename, mode);
+        REQUIRE(trace.is_open());
+        if (mode == TRACE_MEMORY) {
+            mmu.set_memory_observer(&trace);
+        }
+
+        uint64_t cycles = 0;
+        for (size_t i = 0; i < steps; i++) {
+            trace.record_instruction(cpu, cycles);
+            cycles += cpu.step();
+        }
+        mmu.set_memory_observer(nullptr);
+    }
+
+    auto entries = read_trace(filename, header);
+    std::remove(filename.c_str());
+    return entries;
+}
+
+TEST_CASE("Trace Modes", TRACE_TEST) {
+    TraceMode mode;
+    REQUIRE(parse_trace_mode("branch", mode));
+    REQUIRE(mode == TRACE_BRANCH);
+    REQUIRE_FALSE(parse_trace_mode("all", mode));
+}
+
+TEST_CASE("Trace Recording", TRACE_TEST) {
+    TraceHeader header;
+
+    SECTION("full traces every instruction with the state before it") {
+        auto entries = trace_loop(TRACE_FULL, 6, header);
+        REQUIRE(std::memcmp(header.magic, kTraceMagic, sizeof(header.magic)) == 0);
+        REQUIRE(header.version == kTraceVersion);
+        REQUIRE(header.entry_size == kTraceEntrySize);
+        REQUIRE(header.mode == TRACE_FULL);
+
+        REQUIRE(entries.size() == 6);
+        const uint16_t pcs[] = {0xc000, 0xc001, 0xc004, 0xc000, 0xc001, 0xc004};
+        for (size_t i = 0; i < entries.size(); i++) {
+            REQUIRE(entries[i].kind == TRACE_INSTRUCTION);
+            REQUIRE(entries[i].pc == pcs[i]);
+        }
+        REQUIRE(entries[1].opcode == 0xfa);
+        REQUIRE(entries[2].af >> 8 == 0x42);
+        REQUIRE(entries[1].cycle < entries[2].cycle);
+    }
+
+    SECTION("branch keeps only targets of taken jumps") {
+        auto entries = trace_loop(TRACE_BRANCH, 6, header);
+        REQUIRE(header.mode == TRACE_BRANCH);
+        REQUIRE(entries.size() == 2);
+        REQUIRE(entries[0].pc == 0xc000);
+        REQUIRE(entries[1].pc == 0xc000);
+    }
+
+    SECTION("memory adds the cpu accesses, not the recorder's own reads") {
+        auto entries = trace_loop(TRACE_MEMORY, 2, header);
+        int fetches = 0;
+        bool loaded = false;
+        for (const auto& entry : entries) {
+            fetches += (entry.kind == TRACE_MEMORY_READ && entry.pc == 0xc000);
+            loaded |= (entry.kind == TRACE_MEMORY_READ && entry.pc == 0xc100 && entry.opcode == 0x42);
+        }
+        REQUIRE(fetches == 1);
+        REQUIRE(loaded);
+    }
+}
+
+TEST_CASE("Trace Blocks", TRACE_TEST) {
+    TraceHeader header;
+
+    // several blocks through the queue, nothing lost on the way
+    auto entries = trace_loop(TRACE_FULL, 3 * 4096 + 7, header);
+    REQUIRE(entries.size() == 3 * 4096 + 7);
+    for (size_t i = 1; i < entries.size(); i++) {
+        REQUIRE(entries[i].cycle > entries[i - 1].cycle);
+    }
+}
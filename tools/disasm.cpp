@@ -0,0 +1,76 @@
+/*
+ * disasm.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "disassembler.hpp"
+
+void usage(const char* program) {
+    std::cout << "usage:\n";
+    std::cout << program << " <rom_file> [output_prefix] [--threads n]\n";
+    std::cout << "writes <output_prefix>.asm, .dot (control flow graph) and .map (code map)\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty() || args.size() > 2) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    std::ifstream file(args[0], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "error: could not open " << args[0] << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string prefix = (args.size() > 1) ? args[1] : args[0];
+
+    GBDisassembler disassembler(rom);
+    auto start = std::chrono::steady_clock::now();
+    disassembler.analyze(threads);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    std::ofstream asm_file(prefix + ".asm");
+    disassembler.write_disassembly(asm_file);
+    std::ofstream dot_file(prefix + ".dot");
+    disassembler.write_cfg(dot_file);
+    if (!asm_file || !dot_file || !disassembler.get_code_map().save(prefix + ".map")) {
+        std::cerr << "error: could not write " << prefix << ".*\n";
+        return 1;
+    }
+
+    const GBCodeMap& code_map = disassembler.get_code_map();
+    std::cout << disassembler.get_bank_count() << " banks, "
+              << code_map.count(CODE_OPCODE) << " instructions, "
+              << code_map.count(CODE_OPCODE | CODE_OPERAND) << " code bytes, "
+              << code_map.count(CODE_TABLE) << " jump table entries, "
+              << disassembler.get_unresolved_count() << " jumps not followed, "
+              << elapsed.count() << " ms on " << threads << " threads\n";
+    return 0;
+}
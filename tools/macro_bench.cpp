@@ -0,0 +1,344 @@
+/*
+ * macro_bench.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+#include "gpu.hpp"
+#include "mmu.hpp"
+#include "frame_sink.hpp"
+#include "input_script.hpp"
+
+// Whole-system benchmark: replays an input movie on a ROM for a fixed
+// number of frames and reports ns per emulated frame.
+//
+// The total comes from uninstrumented runs, the fastest of the
+// repetitions since noise from the host only ever adds time. The subsystem
+// breakdown comes from one more run that timestamps every call. The cost
+// of reading the clock is subtracted and the shares are applied to the
+// total, so the instrumentation doesn't show up in the numbers. PPU work
+// done when the CPU touches video state is counted as CPU time.
+
+const uint32_t kDefaultFrames = 1800;
+const uint32_t kDefaultRepetitions = 5;
+const double kDefaultThreshold = 10; // percent
+
+enum Subsystem {
+    SUBSYSTEM_CPU,
+    SUBSYSTEM_PPU,
+    SUBSYSTEM_TIMER,
+    SUBSYSTEM_INTERRUPTS,
+    SUBSYSTEM_COUNT
+};
+
+const char* const kSubsystemNames[SUBSYSTEM_COUNT] = {"cpu", "ppu", "timer", "interrupts"};
+
+typedef std::chrono::steady_clock Clock;
+typedef std::array<double, SUBSYSTEM_COUNT> SubsystemTimes;
+
+struct Movie {
+    std::string name;
+    std::string rom_filename;
+    std::string input_filename;
+};
+
+// ns per frame by "<movie> total" and "<movie> <subsystem>"
+typedef std::map<std::string, double> Costs;
+
+void usage(const char* program) {
+    std::cout << "usage:\n";
+    std::cout << program << " <name>... [--frames n] [--repetitions n]"
+              << " [--roms dir] [--movies dir]"
+              << " [--baseline file] [--threshold percent] [--update]\n";
+    std::cout << "plays <roms>/<name>.gb with the input of <movies>/<name>.input\n";
+}
+
+class Stopwatch {
+private:
+    Clock::time_point start;
+
+public:
+    Stopwatch() : start(Clock::now()) {}
+
+    // ns since the last lap
+    double lap() {
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double, std::nano>(now - start).count();
+        start = now;
+        return elapsed;
+    }
+};
+
+// ns a Stopwatch::lap() takes, the fastest of a few rounds
+double lap_overhead() {
+    const int kLaps = 10000;
+    double fastest = 0;
+    for (int round = 0; round < 5; round++) {
+        Stopwatch total;
+        Stopwatch watch;
+        for (int i = 0; i < kLaps; i++) {
+            watch.lap();
+        }
+        double per_lap = total.lap() / kLaps;
+        fastest = (round == 0) ? per_lap : std::min(fastest, per_lap);
+    }
+    return fastest;
+}
+
+// Same loop as gb_headless, returns the ns the frames took. Instrumented
+// runs also add up the time spent per subsystem.
+template <bool kInstrumented>
+double play(const Movie& movie, uint32_t frame_count, SubsystemTimes& times, uint64_t& steps) {
+    std::unique_ptr<GBCartridge> cartridge(new GBCartridge());
+    cartridge->load(movie.rom_filename.c_str());
+    if (!cartridge->is_loaded()) {
+        throw std::runtime_error("could not load " + movie.rom_filename);
+    }
+
+    GBInputScript input;
+    if (!input.load(movie.input_filename)) {
+        throw std::runtime_error("could not load " + movie.input_filename);
+    }
+
+    GBMMU mmu(cartridge);
+    GBCPU cpu(mmu);
+    GBGPU gpu(mmu);
+    NullFrameSink sink;
+    gpu.set_frame_sink(&sink);
+
+    cpu.unload_bios();
+    mmu.set_joypad_state(input.state_at(0));
+
+    Stopwatch total;
+    Stopwatch watch;
+
+    tick_t clock = 0;
+    uint32_t frames = 0;
+    while (frames < frame_count) {
+        steps++;
+        tick_t t = cpu.step();
+        if (kInstrumented) {
+            times[SUBSYSTEM_CPU] += watch.lap();
+        }
+
+        gpu.tick(t);
+        if (kInstrumented) {
+            times[SUBSYSTEM_PPU] += watch.lap();
+        }
+
+        mmu.step(t);
+        if (kInstrumented) {
+            times[SUBSYSTEM_TIMER] += watch.lap();
+        }
+        clock += t;
+
+        if (clock >= kTicksPerLcdFrame) {
+            clock -= kTicksPerLcdFrame;
+            frames += 1;
+            mmu.set_joypad_state(input.state_at(frames));
+        }
+
+        t = cpu.service_interrupts();
+        if (t) {
+            gpu.tick(t);
+            mmu.step(t);
+            clock += t;
+        }
+        if (kInstrumented) {
+            times[SUBSYSTEM_INTERRUPTS] += watch.lap();
+        }
+    }
+
+    return total.lap();
+}
+
+Costs measure(const Movie& movie, uint32_t frames, uint32_t repetitions) {
+    SubsystemTimes times;
+    times.fill(0);
+    uint64_t steps = 0;
+
+    // warm-up, also checks that the movie plays
+    play<false>(movie, frames, times, steps);
+
+    double total = 0;
+    for (uint32_t i = 0; i < repetitions; i++) {
+        double cost = play<false>(movie, frames, times, steps) / frames;
+        total = (i == 0) ? cost : std::min(total, cost);
+    }
+
+    steps = 0;
+    play<true>(movie, frames, times, steps);
+    double overhead = lap_overhead() * steps;
+    double instrumented = 0;
+    for (double& spent : times) {
+        spent = std::max(spent - overhead, 0.0);
+        instrumented += spent;
+    }
+
+    Costs costs;
+    costs[movie.name + " total"] = total;
+    for (int i = 0; i < SUBSYSTEM_COUNT; i++) {
+        costs[movie.name + " " + kSubsystemNames[i]] = total * times[i] / instrumented;
+    }
+    return costs;
+}
+
+// "<movie> <total|subsystem> <ns per frame>" lines, '#' starts a comment
+bool load_baseline(const std::string& filename, Costs& baseline) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string movie;
+        std::string part;
+        double cost = 0;
+        if (fields >> movie >> part >> cost) {
+            baseline[movie + " " + part] = cost;
+        }
+    }
+    return true;
+}
+
+bool save_baseline(const std::string& filename, const Costs& costs, uint32_t frames) {
+    std::ofstream file(filename);
+    file << "# gb_macro_bench baseline, ns per emulated frame over " << frames << " frames\n";
+    file << std::fixed << std::setprecision(0);
+    for (const auto& cost : costs) {
+        file << cost.first << " " << cost.second << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+std::string compare(double cost, const Costs& baseline, const std::string& key, double& change) {
+    auto expected = baseline.find(key);
+    if (expected == baseline.end() || expected->second <= 0) {
+        return "";
+    }
+
+    change = (cost / expected->second - 1) * 100;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "  baseline " << expected->second / 1000 << " us, "
+        << (change >= 0 ? "+" : "") << change << "%";
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> names;
+    uint32_t frames = kDefaultFrames;
+    uint32_t repetitions = kDefaultRepetitions;
+    std::string rom_dir = "roms";
+    std::string movie_dir = "test/golden";
+    std::string baseline_filename;
+    double threshold = kDefaultThreshold;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            repetitions = std::strtoul(argv[++i], nullptr, 10);
+        } else if ((arg == "--roms" || arg == "--movies") && i + 1 < argc) {
+            (arg == "--roms" ? rom_dir : movie_dir) = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_filename = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--update") {
+            update = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            names.push_back(arg);
+        }
+    }
+
+    if (names.empty() || frames == 0 || repetitions == 0 || (update && baseline_filename.empty())) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Costs baseline;
+    if (!update && !baseline_filename.empty() && !load_baseline(baseline_filename, baseline)) {
+        std::cerr << "error: no baseline at " << baseline_filename << "\n"
+                  << "baselines only hold for the host they were recorded on, record one"
+                  << " on this machine first (make bench-macro-update)\n";
+        return 1;
+    }
+
+    Costs costs;
+    std::vector<std::string> regressions;
+    for (const auto& name : names) {
+        Movie movie = {name, rom_dir + "/" + name + ".gb", movie_dir + "/" + name + ".input"};
+
+        Costs movie_costs;
+        try {
+            movie_costs = measure(movie, frames, repetitions);
+        } catch (std::exception& e) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
+        }
+        costs.insert(movie_costs.begin(), movie_costs.end());
+
+        double change = 0;
+        double total = movie_costs[name + " total"];
+        std::cout << std::fixed << std::setprecision(1)
+                  << name << ": " << frames << " frames, " << total / 1000 << " us/frame"
+                  << compare(total, baseline, name + " total", change) << "\n";
+        if (change > threshold) {
+            std::ostringstream regression;
+            regression << std::fixed << std::setprecision(1)
+                       << name << " is " << change << "% slower than the baseline";
+            regressions.push_back(regression.str());
+        }
+
+        for (int i = 0; i < SUBSYSTEM_COUNT; i++) {
+            std::string key = name + " " + kSubsystemNames[i];
+            double cost = movie_costs[key];
+            std::cout << "  " << std::left << std::setw(12) << kSubsystemNames[i] << std::right
+                      << std::setw(5) << cost * 100 / total << "%  "
+                      << std::setw(8) << cost / 1000 << " us"
+                      << compare(cost, baseline, key, change) << "\n";
+        }
+    }
+
+    if (update) {
+        if (!save_baseline(baseline_filename, costs, frames)) {
+            std::cerr << "error: could not write " << baseline_filename << "\n";
+            return 1;
+        }
+        std::cout << "baseline written to " << baseline_filename << "\n";
+        return 0;
+    }
+
+    if (!regressions.empty()) {
+        std::cerr << "\n*** PERFORMANCE REGRESSION, threshold " << threshold << "% ***\n";
+        for (const auto& regression : regressions) {
+            std::cerr << "*** " << regression << "\n";
+        }
+        return 1;
+    }
+    return 0;
+}
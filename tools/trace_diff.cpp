@@ -0,0 +1,117 @@
+/*
+ * trace_diff.cpp
+ * Copyright (C) 2017 Emiliano Firmino <emiliano.firmino@gmail.com>
+ *
+ * Distributed under terms of the MIT license.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "trace.hpp"
+
+// Compares two traces a chunk at a time, memcmp finds a differing chunk
+// and only that chunk is walked entry by entry.
+const size_t kChunkEntries  = (1 << 20) / kTraceEntrySize;
+const size_t kDefaultContext = 8;
+
+void usage(const char* program) {
+    std::cout << "usage:\n";
+    std::cout << program << " <expected.trace> <actual.trace> [context_entries]\n";
+}
+
+bool read_header(FILE* file, const char* filename, TraceHeader& header) {
+    if (std::fread(&header, sizeof(header), 1, file) != 1
+            || std::memcmp(header.magic, kTraceMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "error: " << filename << " is not a trace\n";
+        return false;
+    }
+    if (header.version != kTraceVersion || header.entry_size != kTraceEntrySize) {
+        std::cerr << "error: " << filename << " is trace version " << header.version
+                  << ", expected " << kTraceVersion << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Entries [first, last) of a trace, read again for the report
+std::vector<TraceEntry> read_entries(FILE* file, uint64_t first, uint64_t last) {
+    std::vector<TraceEntry> entries(last - first);
+    std::fseek(file, static_cast<long>(sizeof(TraceHeader) + first * kTraceEntrySize), SEEK_SET);
+    entries.resize(std::fread(entries.data(), kTraceEntrySize, entries.size(), file));
+    return entries;
+}
+
+void print_context(FILE* file, const char* name, uint64_t first, uint64_t last, uint64_t mark) {
+    std::cout << name << ":\n";
+    auto entries = read_entries(file, first, last);
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::cout << (first + i == mark ? "> " : "  ") << first + i << " "
+                  << format_trace_entry(entries[i]) << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 0;
+    }
+    size_t context = (argc > 3) ? std::strtoul(argv[3], nullptr, 10) : kDefaultContext;
+
+    FILE* expected = std::fopen(argv[1], "rb");
+    FILE* actual = std::fopen(argv[2], "rb");
+    if (!expected || !actual) {
+        std::cerr << "error: could not open " << (expected ? argv[2] : argv[1]) << "\n";
+        return 2;
+    }
+
+    TraceHeader expected_header, actual_header;
+    if (!read_header(expected, argv[1], expected_header) || !read_header(actual, argv[2], actual_header)) {
+        return 2;
+    }
+    if (expected_header.mode != actual_header.mode) {
+        std::cerr << "error: traces were recorded in different modes\n";
+        return 2;
+    }
+
+    std::vector<TraceEntry> a(kChunkEntries), b(kChunkEntries);
+    uint64_t offset = 0;
+    uint64_t divergence = UINT64_MAX;
+    while (divergence == UINT64_MAX) {
+        size_t na = std::fread(a.data(), kTraceEntrySize, a.size(), expected);
+        size_t nb = std::fread(b.data(), kTraceEntrySize, b.size(), actual);
+        size_t n = std::min(na, nb);
+
+        if (std::memcmp(a.data(), b.data(), n * kTraceEntrySize) != 0) {
+            size_t i = 0;
+            while (std::memcmp(&a[i], &b[i], kTraceEntrySize) == 0) {
+                i++;
+            }
+            divergence = offset + i;
+        } else if (na != nb) {
+            divergence = offset + n; // one trace ends early
+        } else if (na == 0) {
+            break;
+        }
+        offset += n;
+    }
+
+    if (divergence == UINT64_MAX) {
+        std::cout << "traces match, " << offset << " entries\n";
+        return 0;
+    }
+
+    std::cout << "traces diverge at entry " << divergence << "\n";
+    uint64_t first = (divergence > context) ? divergence - context : 0;
+    print_context(expected, argv[1], first, divergence + context + 1, divergence);
+    print_context(actual, argv[2], first, divergence + context + 1, divergence);
+
+    std::fclose(expected);
+    std::fclose(actual);
+    return 1;
+}